@@ -0,0 +1,294 @@
+// Copyright (c) 2017, Lawrence Livermore National Security, LLC. Produced at
+// the Lawrence Livermore National Laboratory. LLNL-CODE-734707. All Rights
+// reserved. See files LICENSE and NOTICE for details.
+//
+// This file is part of CEED, a collection of benchmarks, miniapps, software
+// libraries and APIs for efficient high-order finite element and spectral
+// element discretizations for exascale applications. For more information and
+// source code availability see http://github.com/ceed.
+//
+// The CEED research is supported by the Exascale Computing Project 17-SC-20-SC,
+// a collaborative effort of two U.S. Department of Energy organizations (Office
+// of Science and the National Nuclear Security Administration) responsible for
+// the planning and preparation of a capable exascale ecosystem, including
+// software, applications, hardware, advanced system engineering and early
+// testbed platforms, in support of the nation's exascale computing imperative.
+
+//                 Laghos kernel microbenchmarks
+//
+// Times the partial assembly kernels of Laghos in isolation: the force action
+// and its transpose (ForcePAOperator), the quadrature data update (QUpdate)
+// and the velocity and energy mass actions (MassPAOperator). They are applied
+// to a synthetic state on a Cartesian mesh, for each supported dimension and
+// kinematic order, i.e., each (dim, D1D, Q1D) combination of the kernels, so
+// the timings contain no CG convergence or setup effects. Each kernel is run
+// for a number of warm-up iterations, and then for a number of timed
+// repetitions, each of them bracketed by barriers. The output is in CSV format,
+// with one line per kernel and combination: the average and minimum over the
+// repetitions of the maximum time over the ranks, the throughput in megadofs
+// (or megaquads for the quadrature update) per second, and the GFLOP/s and
+// GB/s of the analytical model of laghos_perf.hpp.
+//
+// Compile with: make bench
+//
+// Sample runs:
+//    bench/laghos_bench
+//    mpirun -np 4 bench/laghos_bench -ne 32768 -r 50 -o bench.csv
+//    bench/laghos_bench -dim 3 -ok 2 -d cuda
+
+#include "laghos_solver.hpp"
+#include "laghos_mesh.hpp"
+#include "laghos_perf.hpp"
+#include <cmath>
+#include <fstream>
+#include <iostream>
+
+using namespace mfem;
+using namespace mfem::hydrodynamics;
+
+struct BenchResult
+{
+   double t_avg, t_min;
+};
+
+// Runs f for nwarm untimed and nreps timed iterations.
+template <typename F>
+static BenchResult Bench(MPI_Comm comm, const int nwarm, const int nreps,
+                         F &&f)
+{
+   for (int i = 0; i < nwarm; i++) { f(); }
+   MFEM_DEVICE_SYNC;
+   BenchResult r = { 0.0, 1e100 };
+   for (int i = 0; i < nreps; i++)
+   {
+      MPI_Barrier(comm);
+      const double t0 = MPI_Wtime();
+      f();
+      MFEM_DEVICE_SYNC;
+      double t = MPI_Wtime() - t0;
+      MPI_Allreduce(MPI_IN_PLACE, &t, 1, MPI_DOUBLE, MPI_MAX, comm);
+      r.t_avg += t / nreps;
+      r.t_min = std::min(r.t_min, t);
+   }
+   return r;
+}
+
+// Smooth synthetic state, with compression in parts of the domain so that the
+// artificial viscosity terms are evaluated.
+static void VelocityField(const Vector &x, Vector &v)
+{
+   for (int d = 0; d < x.Size(); d++)
+   {
+      v(d) = 0.1 * sin(0.1 * x(d)) * cos(0.1 * x((d + 1) % x.Size()));
+   }
+}
+
+static double EnergyField(const Vector &x) { return 1.0 + 0.01 * x(0); }
+
+// Benchmarks all kernels for the given kinematic order on the mesh, and
+// writes their CSV lines to csv on the root rank.
+static void BenchCase(ParMesh *pmesh, const int order_v, const int nwarm,
+                      const int nreps, std::ostream &csv)
+{
+   const MPI_Comm comm = pmesh->GetComm();
+   const int dim = pmesh->Dimension(), nranks = pmesh->GetNRanks();
+   const bool root = pmesh->GetMyRank() == 0;
+   const int order_e = order_v - 1;
+   const int NE = pmesh->GetNE();
+   const long long global_NE = GlobalCount(comm, NE);
+
+   L2_FECollection L2FEC(order_e, dim, BasisType::Positive);
+   H1_FECollection H1FEC(order_v, dim);
+   ParFiniteElementSpace L2FESpace(pmesh, &L2FEC);
+   ParFiniteElementSpace H1FESpace(pmesh, &H1FEC, dim);
+   ParFiniteElementSpace H1cFESpace(pmesh, &H1FEC, 1);
+   const int Vsize_h1 = H1FESpace.GetVSize();
+   const int Vsize_l2 = L2FESpace.GetVSize();
+   Array<int> offset(4);
+   offset[0] = 0;
+   offset[1] = offset[0] + Vsize_h1;
+   offset[2] = offset[1] + Vsize_h1;
+   offset[3] = offset[2] + Vsize_l2;
+   BlockVector S(offset, Device::GetMemoryType());
+   ParGridFunction x_gf, v_gf, e_gf;
+   x_gf.MakeRef(&H1FESpace, S, offset[0]);
+   v_gf.MakeRef(&H1FESpace, S, offset[1]);
+   e_gf.MakeRef(&L2FESpace, S, offset[2]);
+   pmesh->SetNodalGridFunction(&x_gf);
+   x_gf.SyncAliasMemory(S);
+   VectorFunctionCoefficient v_coeff(dim, VelocityField);
+   v_gf.ProjectCoefficient(v_coeff);
+   v_gf.SyncAliasMemory(S);
+   FunctionCoefficient e_coeff(EnergyField);
+   e_gf.ProjectCoefficient(e_coeff);
+   e_gf.SyncAliasMemory(S);
+   L2_FECollection mat_fec(0, dim);
+   ParFiniteElementSpace mat_fes(pmesh, &mat_fec);
+   ParGridFunction gamma_gf(&mat_fes);
+   gamma_gf = 1.4;
+
+   // Same rule as in LagrangianHydroOperator. The reference data is that of
+   // the unit zones: identity Jacobians and unit density.
+   const IntegrationRule &ir = IntRules.Get(pmesh->GetElementBaseGeometry(0),
+                                            3 * order_v + order_e - 1);
+   const int NQ = ir.GetNPoints();
+   const int Q1D = IntRules.Get(Geometry::SEGMENT, ir.GetOrder()).GetNPoints();
+   const int D1D = order_v + 1, L1D = order_e + 1;
+   QuadratureData qdata(dim, NE, NQ);
+   qdata.h0 = 1.0 / order_v;
+   qdata.dt_est = 1.0;
+   qdata.Jac0inv = 0.0;
+   for (int e = 0; e < NE; e++)
+   {
+      for (int q = 0; q < NQ; q++)
+      {
+         for (int d = 0; d < dim; d++)
+         {
+            qdata.Jac0inv(e*NQ + q)(d, d) = 1.0;
+         }
+         qdata.rho0DetJ0w(e*NQ + q) = ir.IntPoint(q).weight;
+      }
+   }
+   ConstantCoefficient rho0_coeff(1.0);
+   TimingData timer(L2FESpace.TrueVSize());
+   QUpdate qupdate(dim, NE, Q1D, true, false, 0.5, &timer, gamma_gf, ir,
+                   H1FESpace, L2FESpace);
+   qupdate.UpdateQuadratureData(S, qdata);
+   ForcePAOperator force(qdata, H1FESpace, L2FESpace, ir);
+   MassPAOperator vmass(H1cFESpace, ir, rho0_coeff);
+   MassPAOperator emass(L2FESpace, ir, rho0_coeff);
+   H1FESpace.GetParMesh()->GetNodes()->ReadWrite();
+
+   Vector one(Vsize_l2), rhs(Vsize_h1), e_rhs(Vsize_l2);
+   Vector xc(H1cFESpace.GetTrueVSize()), yc(xc.Size());
+   Vector xe(L2FESpace.GetTrueVSize()), ye(xe.Size());
+   one.UseDevice(true); rhs.UseDevice(true); e_rhs.UseDevice(true);
+   xc.UseDevice(true); yc.UseDevice(true);
+   xe.UseDevice(true); ye.UseDevice(true);
+   one = 1.0; xc = 1.0; xe = 1.0;
+
+   const long long h1_tdofs = GlobalCount(comm, H1FESpace.TrueVSize());
+   const long long h1c_tdofs = GlobalCount(comm, xc.Size());
+   const long long l2_tdofs = GlobalCount(comm, xe.Size());
+   struct Kernel
+   {
+      const char *name;
+      long long units;
+      KernelCost cost;
+   };
+   const Kernel kernels[5] =
+   {
+      { "force", h1_tdofs + l2_tdofs, ForceCost(dim, D1D, Q1D, L1D) },
+      {
+         "force_transpose", h1_tdofs + l2_tdofs,
+         ForceTransposeCost(dim, D1D, Q1D, L1D)
+      },
+      { "qupdate", global_NE * NQ, QKernelCost(dim, Q1D) },
+      { "mass_h1", h1c_tdofs, MassCost(dim, D1D, Q1D) },
+      { "mass_l2", l2_tdofs, MassCost(dim, L1D, Q1D) }
+   };
+   for (int k = 0; k < 5; k++)
+   {
+      BenchResult r;
+      switch (k)
+      {
+         case 0:
+            r = Bench(comm, nwarm, nreps, [&] { force.Mult(one, rhs); });
+            break;
+         case 1:
+            r = Bench(comm, nwarm, nreps,
+                      [&] { force.MultTranspose(v_gf, e_rhs); });
+            break;
+         case 2:
+            r = Bench(comm, nwarm, nreps,
+                      [&] { qupdate.UpdateQuadratureData(S, qdata); });
+            break;
+         case 3:
+            r = Bench(comm, nwarm, nreps, [&] { vmass.Mult(xc, yc); });
+            break;
+         default:
+            r = Bench(comm, nwarm, nreps, [&] { emass.Mult(xe, ye); });
+      }
+      if (!root) { continue; }
+      const Kernel &kr = kernels[k];
+      csv << nranks << "," << dim << "," << D1D << "," << Q1D << ","
+          << L1D << "," << global_NE << "," << kr.name << "," << nreps
+          << "," << r.t_avg << "," << r.t_min << ","
+          << 1e-6 * kr.units / r.t_avg << ","
+          << 1e-9 * global_NE * kr.cost.flops / r.t_avg << ","
+          << 1e-9 * global_NE * kr.cost.bytes / r.t_avg << std::endl;
+   }
+}
+
+int main(int argc, char *argv[])
+{
+   MPI_Session mpi(argc, argv);
+   const MPI_Comm comm = MPI_COMM_WORLD;
+   const int nranks = mpi.WorldSize();
+
+   int bench_dim = 0, bench_order = 0;
+   int zones = 4096;
+   int nwarm = 5, nreps = 20;
+   const char *device = "cpu";
+   const char *csv_file = "";
+   OptionsParser args(argc, argv);
+   args.AddOption(&bench_dim, "-dim", "--dimension",
+                  "Dimension of the problem, 2 or 3 (0: both).");
+   args.AddOption(&bench_order, "-ok", "--order-kinematic",
+                  "Order of the kinematic space, 2, 3 or 4 (0: all); the\n\t"
+                  "thermodynamic order is one lower.");
+   args.AddOption(&zones, "-ne", "--zones",
+                  "Approximate number of zones per rank.");
+   args.AddOption(&nwarm, "-w", "--warm-up", "Number of warm-up iterations.");
+   args.AddOption(&nreps, "-r", "--repetitions",
+                  "Number of timed repetitions.");
+   args.AddOption(&device, "-d", "--device",
+                  "Device configuration string, see Device::Configure().");
+   args.AddOption(&csv_file, "-o", "--output",
+                  "CSV output file (default: standard output).");
+   args.Parse();
+   if (!args.Good() || nreps < 1 || nwarm < 0 || zones < 1)
+   {
+      if (mpi.Root()) { args.PrintUsage(std::cout); }
+      return 1;
+   }
+
+   Device backend;
+   backend.Configure(device);
+
+   std::ofstream csv_ofs;
+   if (mpi.Root() && csv_file[0] != '\0')
+   {
+      csv_ofs.open(csv_file);
+      MFEM_VERIFY(csv_ofs, "Cannot open " << csv_file);
+   }
+   std::ostream &csv = (csv_file[0] != '\0') ? csv_ofs : std::cout;
+   if (mpi.Root())
+   {
+      csv << "ranks,dim,D1D,Q1D,L1D,zones,kernel,reps,t_avg,t_min,"
+          << "mdofs_per_s,gflops,gbs" << std::endl;
+   }
+
+   for (int dim = 2; dim <= 3; dim++)
+   {
+      if (bench_dim != 0 && dim != bench_dim) { continue; }
+      for (int order_v = 2; order_v <= 4; order_v++)
+      {
+         if (bench_order != 0 && order_v != bench_order) { continue; }
+         // Cartesian mesh of unit zones, n^dim per rank, split along x.
+         const int n = std::max(1, int(floor(pow(zones, 1.0 / dim) + 0.5)));
+         Array<int> nxyz(dim), cxyz(dim);
+         Vector lxyz(dim);
+         for (int d = 0; d < dim; d++)
+         {
+            nxyz[d] = (d == 0) ? n * nranks : n;
+            cxyz[d] = (d == 0) ? nranks : 1;
+            lxyz(d) = nxyz[d];
+         }
+         ParMesh *pmesh = MakeCartesianParMesh(comm, nxyz, cxyz, lxyz);
+         BenchCase(pmesh, order_v, nwarm, nreps, csv);
+         delete pmesh;
+      }
+   }
+   return 0;
+}
@@ -59,10 +59,18 @@
 // -m data/cube_522_hex.mesh -pt 521 for 10 / 80 / 640 / 5120 ... tasks.
 // -m data/cube_12_hex.mesh  -pt 322 for 12 / 96 / 768 / 6144 ... tasks.
 
+#include <cstdlib>
 #include <fstream>
 #include <sys/time.h>
 #include <sys/resource.h>
 #include "laghos_solver.hpp"
+#include "laghos_insitu.hpp"
+#include "laghos_io.hpp"
+#include "laghos_memory.hpp"
+#include "laghos_mesh.hpp"
+#include "laghos_perf.hpp"
+#include "laghos_shm.hpp"
+#include "laghos_trace.hpp"
 
 using std::cout;
 using std::endl;
@@ -97,6 +105,8 @@ int main(int argc, char *argv[])
    int rs_levels = 2;
    int rp_levels = 0;
    Array<int> cxyz;
+   Array<int> nxyz_gen;
+   Vector lxyz_gen;
    int order_v = 2;
    int order_e = 1;
    int order_q = -1;
@@ -113,13 +123,34 @@ int main(int argc, char *argv[])
    int vis_steps = 5;
    bool visit = false;
    bool gfprint = false;
+   bool print_mpiio = false;
+   double compress_abs_tol = 0.0, compress_rel_tol = 0.0;
+   bool compress_check = false;
+   int async_output = 0;
+   int visit_group = 0;
+   int insitu_bins = 0;
+   const char *shm_name = "";
    const char *basename = "results/Laghos";
    int partition_type = 0;
+   int sfc_partition = 0;
    const char *device = "cpu";
    bool check = false;
    bool mem_usage = false;
+   bool reorder_mesh = false;
    bool fom = false;
+   bool phase_timers = false;
+   const char *trace_file = "";
+   int trace_events = 1 << 16;
+   bool perf_counters = false;
+   const char *perf_fp_event = "0";
+   bool roofline = false;
+   bool energy_monitor = false;
+   int checkpoint_steps = 0;
+   const char *restart_prefix = "";
+   const char *save_partition = "", *load_partition = "";
    bool gpu_aware_mpi = false;
+   bool node_local_exchange = false;
+   bool first_touch = false, huge_pages = false;
    int dev = 0;
    double blast_energy = 0.25;
    double blast_position[] = {0.0, 0.0, 0.0};
@@ -133,6 +164,11 @@ int main(int argc, char *argv[])
                   "Number of times to refine the mesh uniformly in parallel.");
    args.AddOption(&cxyz, "-c", "--cartesian-partitioning",
                   "Use Cartesian partitioning.");
+   args.AddOption(&nxyz_gen, "-nxyz", "--cartesian-zones",
+                  "Generate an nx x ny x nz Cartesian mesh directly in\n\t"
+                  "parallel, with the rank layout of -c (no serial mesh).");
+   args.AddOption(&lxyz_gen, "-lxyz", "--cartesian-lengths",
+                  "Side lengths of the box of -nxyz; the default is 1.");
    args.AddOption(&problem, "-p", "--problem", "Problem setup to use.");
    args.AddOption(&order_v, "-ok", "--order-kinematic",
                   "Order (degree) of the kinematic finite element space.");
@@ -170,6 +206,32 @@ int main(int argc, char *argv[])
                   "Enable or disable VisIt visualization.");
    args.AddOption(&gfprint, "-print", "--print", "-no-print", "--no-print",
                   "Enable or disable result output (files in mfem format).");
+   args.AddOption(&print_mpiio, "-pio", "--print-mpiio", "-no-pio",
+                  "--no-print-mpiio",
+                  "With -print, write each output step into one binary file\n\t"
+                  "with collective MPI-IO instead of gathering on rank 0.");
+   args.AddOption(&compress_abs_tol, "-cza", "--compress-abs-tol",
+                  "With -print, write error-bounded compressed fields with\n\t"
+                  "this absolute tolerance instead of the text files.");
+   args.AddOption(&compress_rel_tol, "-czr", "--compress-rel-tol",
+                  "With -print, write error-bounded compressed fields with\n\t"
+                  "this tolerance relative to the maximum of each field.");
+   args.AddOption(&compress_check, "-czc", "--compress-check", "-no-czc",
+                  "--no-compress-check",
+                  "Reload each compressed output and verify its error bound.");
+   args.AddOption(&async_output, "-aio", "--async-output",
+                  "Number of snapshot buffers of the background thread that\n\t"
+                  "writes the -visit and -print (without -pio) files.\n\t"
+                  "0 writes them synchronously.");
+   args.AddOption(&visit_group, "-vg", "--visit-group-size",
+                  "With -visit, aggregate the output of groups of this many\n\t"
+                  "ranks into one file per group. 0 writes a file per rank.");
+   args.AddOption(&insitu_bins, "-insitu", "--insitu-bins",
+                  "Number of histogram bins of the in-situ analysis, done\n\t"
+                  "every time step. 0 disables the analysis.");
+   args.AddOption(&shm_name, "-shm", "--shared-memory",
+                  "Export the state and the density of each rank on the\n\t"
+                  "output steps to the POSIX shared memory /<name>.<rank>.");
    args.AddOption(&basename, "-k", "--outputfilename",
                   "Name of the visit dump files");
    args.AddOption(&partition_type, "-pt", "--partition",
@@ -181,14 +243,70 @@ int main(int argc, char *argv[])
                   "of zones in each direction, e.g., the number of zones in direction x\n\t"
                   "must be divisible by the number of MPI tasks in direction x.\n\t"
                   "Available options: 11, 21, 111, 211, 221, 311, 321, 322, 432.");
+   args.AddOption(&sfc_partition, "-sfc", "--sfc-partitioning",
+                  "Space-filling-curve partitioning of the serial mesh for\n\t"
+                  "any number of tasks, instead of -pt, -c and METIS:\n\t"
+                  "0 - off, 1 - Hilbert curve, 2 - Morton curve.");
    args.AddOption(&device, "-d", "--device",
                   "Device configuration string, see Device::Configure().");
    args.AddOption(&check, "-chk", "--checks", "-no-chk", "--no-checks",
                   "Enable 2D checks.");
+   args.AddOption(&reorder_mesh, "-reo", "--reorder", "-no-reo",
+                  "--no-reorder",
+                  "Reorder the zones of the serial mesh along a Hilbert\n\t"
+                  "curve and its vertices in the order of first use, before\n\t"
+                  "the partitioning, for the memory locality of local data.\n\t"
+                  "No first-touch DOF ordering is done: the DOFs follow\n\t"
+                  "the renumbered vertices. Not available with -nxyz,\n\t"
+                  "-load-partition or -restart.");
    args.AddOption(&mem_usage, "-mb", "--mem", "-no-mem", "--no-mem",
                   "Enable memory usage.");
+   args.AddOption(&phase_timers, "-pht", "--phase-timers", "-no-pht",
+                  "--no-phase-timers",
+                  "Print the min/avg/max times over the ranks of each phase.");
+   args.AddOption(&trace_file, "-trace", "--trace",
+                  "Write a timeline of the main phases of each rank to the\n\t"
+                  "given file, in the Chrome trace-event JSON format.");
+   args.AddOption(&trace_events, "-trace-events", "--trace-events",
+                  "Number of most recent events kept by each rank for -trace.");
+   args.AddOption(&perf_counters, "-perf", "--perf-counters", "-no-perf",
+                  "--no-perf-counters",
+                  "Measure the cycles, instructions and cache misses of the\n\t"
+                  "major kernels with the Linux hardware counters.");
+   args.AddOption(&perf_fp_event, "-perf-fp", "--perf-fp-event",
+                  "Code of a raw hardware event counting the floating-point\n\t"
+                  "operations for -perf, e.g., 0x15c7 on Intel (0: none).");
+   args.AddOption(&roofline, "-roof", "--roofline", "-no-roof",
+                  "--no-roofline",
+                  "Print the achieved GFLOP/s, GB/s and arithmetic\n\t"
+                  "intensity of the major kernels, and their fraction of\n\t"
+                  "the memory roof, from the bandwidth measured at startup.");
    args.AddOption(&fom, "-f", "--fom", "-no-fom", "--no-fom",
                   "Enable figure of merit output.");
+   args.AddOption(&energy_monitor, "-em", "--energy-monitor", "-no-em",
+                  "--no-energy-monitor",
+                  "Monitor the total energy conservation at every time step.");
+   args.AddOption(&checkpoint_steps, "-cks", "--checkpoint-steps",
+                  "Write a checkpoint every n-th timestep (0 disables them).");
+   args.AddOption(&restart_prefix, "-restart", "--restart",
+                  "Resume from the checkpoint with the given prefix, e.g.,\n\t"
+                  "results/Laghos_ckpt_000100 (same number of MPI tasks).");
+   args.AddOption(&save_partition, "-save-partition", "--save-partition",
+                  "Write the refined and partitioned mesh to the given file.");
+   args.AddOption(&load_partition, "-load-partition", "--load-partition",
+                  "Read the mesh written by -save-partition (same number of\n\t"
+                  "MPI tasks), instead of refining and partitioning it.");
+   args.AddOption(&node_local_exchange, "-nlx", "--node-local-exchange",
+                  "-no-nlx", "--no-node-local-exchange",
+                  "Exchange the shared velocity dofs of the ranks of a node\n\t"
+                  "through MPI-3 shared memory (partial assembly, CPU).");
+   args.AddOption(&first_touch, "-ft", "--first-touch", "-no-ft",
+                  "--no-first-touch",
+                  "Place the state and the zone data on the NUMA domains of\n\t"
+                  "the threads that process them (CPU).");
+   args.AddOption(&huge_pages, "-hp", "--huge-pages", "-no-hp",
+                  "--no-huge-pages",
+                  "Use transparent huge pages for the data of -ft.");
    args.AddOption(&gpu_aware_mpi, "-gam", "--gpu-aware-mpi", "-no-gam",
                   "--no-gpu-aware-mpi", "Enable GPU aware MPI communications.");
    args.AddOption(&dev, "-dev", "--dev", "GPU device to use.");
@@ -200,204 +318,336 @@ int main(int argc, char *argv[])
    }
    if (mpi.Root()) { args.PrintOptions(cout); }
 
+   // The counters are opened before any thread is created, so that they also
+   // count the threads of the kernels.
+   if (perf_counters &&
+       !hydrodynamics::PerfInit(std::strtoll(perf_fp_event, NULL, 0)) &&
+       mpi.Root())
+   {
+      cout << "No hardware counters available, check "
+           << "/proc/sys/kernel/perf_event_paranoid." << endl;
+   }
+   if (roofline)
+   {
+      const double bw = hydrodynamics::RooflineInit(MPI_COMM_WORLD);
+      if (mpi.Root())
+      {
+         cout << "STREAM triad bandwidth of rank 0: " << bw << " GB/s" << endl;
+      }
+   }
+
    // Configure the device from the command line options
    Device backend;
    backend.Configure(device, dev);
    if (mpi.Root()) { backend.Print(); }
    backend.SetGPUAwareMPI(gpu_aware_mpi);
 
-   // On all processors, use the default builtin 1D/2D/3D mesh or read the
-   // serial one given on the command line.
-   Mesh *mesh;
-   if (strncmp(mesh_file, "default", 7) != 0)
+   // When restarting, the partitioned mesh is read from the checkpoint files of
+   // the ranks, and its nodes are set below from the saved positions. With
+   // -load-partition, each rank reads its part of a mesh saved by a previous
+   // run with -save-partition, and the -rs and -rp refinements are not applied
+   // again. With -nxyz, each rank generates its part of a Cartesian mesh.
+   // Otherwise, on all processors, use the default builtin 1D/2D/3D mesh or
+   // read the serial one given on the command line, and partition it.
+   const bool restart = restart_prefix[0] != '\0';
+   const bool shm_export = shm_name[0] != '\0';
+   MFEM_VERIFY(!reorder_mesh || (!restart && load_partition[0] == '\0' &&
+                                 nxyz_gen.Size() == 0),
+               "-reo reorders the serial mesh, so it cannot be combined with "
+               "-nxyz, -load-partition or -restart.");
+   hydrodynamics::Checkpoint ckpt;
+   ParMesh *pmesh = nullptr;
+   if (restart)
+   {
+      pmesh = hydrodynamics::LoadCheckpoint(restart_prefix, MPI_COMM_WORLD,
+                                            ckpt);
+      dim = pmesh->Dimension();
+      if (mpi.Root())
+      {
+         cout << "Restarting from " << restart_prefix << " at step "
+              << ckpt.ti << ", t = " << ckpt.t << endl;
+      }
+   }
+   else if (load_partition[0] != '\0')
    {
-      mesh = new Mesh(mesh_file, true, true);
+      pmesh = hydrodynamics::LoadSnapshotMeshMPIIO(load_partition,
+                                                   MPI_COMM_WORLD);
+      dim = pmesh->Dimension();
+      if (mpi.Root())
+      {
+         cout << "Read the partitioned mesh from " << load_partition << endl;
+      }
+   }
+   else if (nxyz_gen.Size() > 0)
+   {
+      // The serial refinements multiply the number of zones per direction.
+      MFEM_VERIFY(cxyz.Size() == nxyz_gen.Size(),
+                  "-nxyz requires the rank layout -c of the same dimension.");
+      Array<int> nxyz(nxyz_gen.Size());
+      long long mesh_NE = 1;
+      for (int d = 0; d < nxyz.Size(); d++)
+      {
+         nxyz[d] = nxyz_gen[d] << rs_levels;
+         mesh_NE *= nxyz[d];
+      }
+      Vector lxyz(nxyz.Size());
+      lxyz = 1.0;
+      if (lxyz_gen.Size() > 0)
+      {
+         MFEM_VERIFY(lxyz_gen.Size() == nxyz.Size(),
+                     "-lxyz needs one length per direction.");
+         lxyz = lxyz_gen;
+      }
+      pmesh = hydrodynamics::MakeCartesianParMesh(MPI_COMM_WORLD, nxyz, cxyz,
+                                                  lxyz);
+      dim = pmesh->Dimension();
+      if (mpi.Root())
+      {
+         cout << "Number of zones in the generated mesh: " << mesh_NE << endl;
+      }
+      for (int lev = 0; lev < rp_levels; lev++) { pmesh->UniformRefinement(); }
    }
    else
    {
-      if (dim == 1)
+      // On all processors, use the default builtin 1D/2D/3D mesh or read the
+      // serial one given on the command line.
+      Mesh *mesh;
+      if (strncmp(mesh_file, "default", 7) != 0)
       {
-         mesh = new Mesh(Mesh::MakeCartesian1D(2));
-         mesh->GetBdrElement(0)->SetAttribute(1);
-         mesh->GetBdrElement(1)->SetAttribute(1);
+         mesh = new Mesh(mesh_file, true, true);
       }
-      if (dim == 2)
+      else
       {
-         mesh = new Mesh(Mesh::MakeCartesian2D(2, 2, Element::QUADRILATERAL,
-                                               true));
-         const int NBE = mesh->GetNBE();
-         for (int b = 0; b < NBE; b++)
+         if (dim == 1)
          {
-            Element *bel = mesh->GetBdrElement(b);
-            const int attr = (b < NBE/2) ? 2 : 1;
-            bel->SetAttribute(attr);
+            mesh = new Mesh(Mesh::MakeCartesian1D(2));
+            mesh->GetBdrElement(0)->SetAttribute(1);
+            mesh->GetBdrElement(1)->SetAttribute(1);
          }
-      }
-      if (dim == 3)
-      {
-         mesh = new Mesh(Mesh::MakeCartesian3D(2, 2, 2, Element::HEXAHEDRON,
-                                               true));
-         const int NBE = mesh->GetNBE();
-         for (int b = 0; b < NBE; b++)
+         if (dim == 2)
          {
-            Element *bel = mesh->GetBdrElement(b);
-            const int attr = (b < NBE/3) ? 3 : (b < 2*NBE/3) ? 1 : 2;
-            bel->SetAttribute(attr);
+            mesh = new Mesh(Mesh::MakeCartesian2D(2, 2, Element::QUADRILATERAL,
+                                                  true));
+            const int NBE = mesh->GetNBE();
+            for (int b = 0; b < NBE; b++)
+            {
+               Element *bel = mesh->GetBdrElement(b);
+               const int attr = (b < NBE/2) ? 2 : 1;
+               bel->SetAttribute(attr);
+            }
+         }
+         if (dim == 3)
+         {
+            mesh = new Mesh(Mesh::MakeCartesian3D(2, 2, 2, Element::HEXAHEDRON,
+                                                  true));
+            const int NBE = mesh->GetNBE();
+            for (int b = 0; b < NBE; b++)
+            {
+               Element *bel = mesh->GetBdrElement(b);
+               const int attr = (b < NBE/3) ? 3 : (b < 2*NBE/3) ? 1 : 2;
+               bel->SetAttribute(attr);
+            }
          }
       }
-   }
-   dim = mesh->Dimension();
+      dim = mesh->Dimension();
 
-   // 1D vs partial assembly sanity check.
-   if (p_assembly && dim == 1)
-   {
-      p_assembly = false;
+      // Refine the mesh in serial to increase the resolution.
+      for (int lev = 0; lev < rs_levels; lev++) { mesh->UniformRefinement(); }
+      const int mesh_NE = mesh->GetNE();
+
+      // The local zones of each rank keep their order in the serial mesh, and
+      // the local DOFs are numbered from the vertices, edges and faces of the
+      // local zones. Reordering the serial mesh therefore makes the element
+      // gathers and scatters of all the partial assembly kernels local.
+      if (reorder_mesh)
+      {
+         Array<int> ordering;
+         mesh->GetHilbertElementOrdering(ordering);
+         mesh->ReorderElements(ordering, true);
+      }
       if (mpi.Root())
       {
-         cout << "Laghos does not support PA in 1D. Switching to FA." << endl;
+         cout << "Number of zones in the serial mesh: " << mesh_NE << endl;
       }
-   }
-
-   // Refine the mesh in serial to increase the resolution.
-   for (int lev = 0; lev < rs_levels; lev++) { mesh->UniformRefinement(); }
-   const int mesh_NE = mesh->GetNE();
-   if (mpi.Root())
-   {
-      cout << "Number of zones in the serial mesh: " << mesh_NE << endl;
-   }
 
-   // Parallel partitioning of the mesh.
-   ParMesh *pmesh = nullptr;
-   const int num_tasks = mpi.WorldSize(); int unit = 1;
-   int *nxyz = new int[dim];
-   switch (partition_type)
-   {
-      case 0:
-         for (int d = 0; d < dim; d++) { nxyz[d] = unit; }
-         break;
-      case 11:
-      case 111:
-         unit = static_cast<int>(floor(pow(num_tasks, 1.0 / dim) + 1e-2));
-         for (int d = 0; d < dim; d++) { nxyz[d] = unit; }
-         break;
-      case 21: // 2D
-         unit = static_cast<int>(floor(pow(num_tasks / 2, 1.0 / 2) + 1e-2));
-         nxyz[0] = 2 * unit; nxyz[1] = unit;
-         break;
-      case 31: // 2D
-         unit = static_cast<int>(floor(pow(num_tasks / 3, 1.0 / 2) + 1e-2));
-         nxyz[0] = 3 * unit; nxyz[1] = unit;
-         break;
-      case 32: // 2D
-         unit = static_cast<int>(floor(pow(2 * num_tasks / 3, 1.0 / 2) + 1e-2));
-         nxyz[0] = 3 * unit / 2; nxyz[1] = unit;
-         break;
-      case 49: // 2D
-         unit = static_cast<int>(floor(pow(9 * num_tasks / 4, 1.0 / 2) + 1e-2));
-         nxyz[0] = 4 * unit / 9; nxyz[1] = unit;
-         break;
-      case 51: // 2D
-         unit = static_cast<int>(floor(pow(num_tasks / 5, 1.0 / 2) + 1e-2));
-         nxyz[0] = 5 * unit; nxyz[1] = unit;
-         break;
-      case 211: // 3D.
-         unit = static_cast<int>(floor(pow(num_tasks / 2, 1.0 / 3) + 1e-2));
-         nxyz[0] = 2 * unit; nxyz[1] = unit; nxyz[2] = unit;
-         break;
-      case 221: // 3D.
-         unit = static_cast<int>(floor(pow(num_tasks / 4, 1.0 / 3) + 1e-2));
-         nxyz[0] = 2 * unit; nxyz[1] = 2 * unit; nxyz[2] = unit;
-         break;
-      case 311: // 3D.
-         unit = static_cast<int>(floor(pow(num_tasks / 3, 1.0 / 3) + 1e-2));
-         nxyz[0] = 3 * unit; nxyz[1] = unit; nxyz[2] = unit;
-         break;
-      case 321: // 3D.
-         unit = static_cast<int>(floor(pow(num_tasks / 6, 1.0 / 3) + 1e-2));
-         nxyz[0] = 3 * unit; nxyz[1] = 2 * unit; nxyz[2] = unit;
-         break;
-      case 322: // 3D.
-         unit = static_cast<int>(floor(pow(2 * num_tasks / 3, 1.0 / 3) + 1e-2));
-         nxyz[0] = 3 * unit / 2; nxyz[1] = unit; nxyz[2] = unit;
-         break;
-      case 432: // 3D.
-         unit = static_cast<int>(floor(pow(num_tasks / 3, 1.0 / 3) + 1e-2));
-         nxyz[0] = 2 * unit; nxyz[1] = 3 * unit / 2; nxyz[2] = unit;
-         break;
-      case 511: // 3D.
-         unit = static_cast<int>(floor(pow(num_tasks / 5, 1.0 / 3) + 1e-2));
-         nxyz[0] = 5 * unit; nxyz[1] = unit; nxyz[2] = unit;
-         break;
-      case 521: // 3D.
-         unit = static_cast<int>(floor(pow(num_tasks / 10, 1.0 / 3) + 1e-2));
-         nxyz[0] = 5 * unit; nxyz[1] = 2 * unit; nxyz[2] = unit;
-         break;
-      case 522: // 3D.
-         unit = static_cast<int>(floor(pow(num_tasks / 20, 1.0 / 3) + 1e-2));
-         nxyz[0] = 5 * unit; nxyz[1] = 2 * unit; nxyz[2] = 2 * unit;
-         break;
-      case 911: // 3D.
-         unit = static_cast<int>(floor(pow(num_tasks / 9, 1.0 / 3) + 1e-2));
-         nxyz[0] = 9 * unit; nxyz[1] = unit; nxyz[2] = unit;
-         break;
-      case 921: // 3D.
-         unit = static_cast<int>(floor(pow(num_tasks / 18, 1.0 / 3) + 1e-2));
-         nxyz[0] = 9 * unit; nxyz[1] = 2 * unit; nxyz[2] = unit;
-         break;
-      case 922: // 3D.
-         unit = static_cast<int>(floor(pow(num_tasks / 36, 1.0 / 3) + 1e-2));
-         nxyz[0] = 9 * unit; nxyz[1] = 2 * unit; nxyz[2] = 2 * unit;
-         break;
-      default:
-         if (myid == 0)
+      // Parallel partitioning of the mesh.
+      const int num_tasks = mpi.WorldSize(); int unit = 1;
+      int *nxyz = new int[dim];
+      switch (partition_type)
+      {
+         case 0:
+            for (int d = 0; d < dim; d++) { nxyz[d] = unit; }
+            break;
+         case 11:
+         case 111:
+            unit = static_cast<int>(floor(pow(num_tasks, 1.0 / dim) + 1e-2));
+            for (int d = 0; d < dim; d++) { nxyz[d] = unit; }
+            break;
+         case 21: // 2D
+            unit = static_cast<int>(floor(pow(num_tasks / 2, 1.0 / 2) + 1e-2));
+            nxyz[0] = 2 * unit; nxyz[1] = unit;
+            break;
+         case 31: // 2D
+            unit = static_cast<int>(floor(pow(num_tasks / 3, 1.0 / 2) + 1e-2));
+            nxyz[0] = 3 * unit; nxyz[1] = unit;
+            break;
+         case 32: // 2D
+            unit = static_cast<int>(floor(pow(2 * num_tasks / 3, 1.0 / 2) +
+                                          1e-2));
+            nxyz[0] = 3 * unit / 2; nxyz[1] = unit;
+            break;
+         case 49: // 2D
+            unit = static_cast<int>(floor(pow(9 * num_tasks / 4, 1.0 / 2) +
+                                          1e-2));
+            nxyz[0] = 4 * unit / 9; nxyz[1] = unit;
+            break;
+         case 51: // 2D
+            unit = static_cast<int>(floor(pow(num_tasks / 5, 1.0 / 2) + 1e-2));
+            nxyz[0] = 5 * unit; nxyz[1] = unit;
+            break;
+         case 211: // 3D.
+            unit = static_cast<int>(floor(pow(num_tasks / 2, 1.0 / 3) + 1e-2));
+            nxyz[0] = 2 * unit; nxyz[1] = unit; nxyz[2] = unit;
+            break;
+         case 221: // 3D.
+            unit = static_cast<int>(floor(pow(num_tasks / 4, 1.0 / 3) + 1e-2));
+            nxyz[0] = 2 * unit; nxyz[1] = 2 * unit; nxyz[2] = unit;
+            break;
+         case 311: // 3D.
+            unit = static_cast<int>(floor(pow(num_tasks / 3, 1.0 / 3) + 1e-2));
+            nxyz[0] = 3 * unit; nxyz[1] = unit; nxyz[2] = unit;
+            break;
+         case 321: // 3D.
+            unit = static_cast<int>(floor(pow(num_tasks / 6, 1.0 / 3) + 1e-2));
+            nxyz[0] = 3 * unit; nxyz[1] = 2 * unit; nxyz[2] = unit;
+            break;
+         case 322: // 3D.
+            unit = static_cast<int>(floor(pow(2 * num_tasks / 3, 1.0 / 3) +
+                                          1e-2));
+            nxyz[0] = 3 * unit / 2; nxyz[1] = unit; nxyz[2] = unit;
+            break;
+         case 432: // 3D.
+            unit = static_cast<int>(floor(pow(num_tasks / 3, 1.0 / 3) + 1e-2));
+            nxyz[0] = 2 * unit; nxyz[1] = 3 * unit / 2; nxyz[2] = unit;
+            break;
+         case 511: // 3D.
+            unit = static_cast<int>(floor(pow(num_tasks / 5, 1.0 / 3) + 1e-2));
+            nxyz[0] = 5 * unit; nxyz[1] = unit; nxyz[2] = unit;
+            break;
+         case 521: // 3D.
+            unit = static_cast<int>(floor(pow(num_tasks / 10, 1.0 / 3) + 1e-2));
+            nxyz[0] = 5 * unit; nxyz[1] = 2 * unit; nxyz[2] = unit;
+            break;
+         case 522: // 3D.
+            unit = static_cast<int>(floor(pow(num_tasks / 20, 1.0 / 3) + 1e-2));
+            nxyz[0] = 5 * unit; nxyz[1] = 2 * unit; nxyz[2] = 2 * unit;
+            break;
+         case 911: // 3D.
+            unit = static_cast<int>(floor(pow(num_tasks / 9, 1.0 / 3) + 1e-2));
+            nxyz[0] = 9 * unit; nxyz[1] = unit; nxyz[2] = unit;
+            break;
+         case 921: // 3D.
+            unit = static_cast<int>(floor(pow(num_tasks / 18, 1.0 / 3) + 1e-2));
+            nxyz[0] = 9 * unit; nxyz[1] = 2 * unit; nxyz[2] = unit;
+            break;
+         case 922: // 3D.
+            unit = static_cast<int>(floor(pow(num_tasks / 36, 1.0 / 3) + 1e-2));
+            nxyz[0] = 9 * unit; nxyz[1] = 2 * unit; nxyz[2] = 2 * unit;
+            break;
+         default:
+            if (myid == 0)
+            {
+               cout << "Unknown partition type: " << partition_type << '\n';
+            }
+            delete mesh;
+            MPI_Finalize();
+            return 3;
+      }
+      int product = 1;
+      for (int d = 0; d < dim; d++) { product *= nxyz[d]; }
+      const bool cartesian_partitioning = (cxyz.Size()>0)?true:false;
+      MFEM_VERIFY(sfc_partition >= 0 && sfc_partition <= 2,
+                  "Unknown space-filling curve " << sfc_partition);
+      if (sfc_partition == 0 &&
+          (product == num_tasks || cartesian_partitioning))
+      {
+         if (cartesian_partitioning)
          {
-            cout << "Unknown partition type: " << partition_type << '\n';
+            int cproduct = 1;
+            for (int d = 0; d < dim; d++) { cproduct *= cxyz[d]; }
+            MFEM_VERIFY(!cartesian_partitioning || cxyz.Size() == dim,
+                        "Expected " << mesh->SpaceDimension() << " integers "
+                        "with the option --cartesian-partitioning.");
+            MFEM_VERIFY(!cartesian_partitioning || num_tasks == cproduct,
+                        "Expected cartesian partitioning product to match "
+                        "number of ranks.");
          }
-         delete mesh;
-         MPI_Finalize();
-         return 3;
+         int *partitioning = cartesian_partitioning ?
+                             mesh->CartesianPartitioning(cxyz):
+                             mesh->CartesianPartitioning(nxyz);
+         pmesh = new ParMesh(MPI_COMM_WORLD, *mesh, partitioning);
+         delete [] partitioning;
+      }
+      else
+      {
+         // Without -sfc, METIS is used when available, and the Hilbert curve
+         // otherwise.
+#ifdef MFEM_USE_METIS
+         const bool use_metis = (sfc_partition == 0);
+#else
+         const bool use_metis = false;
+#endif
+         if (use_metis)
+         {
+            if (myid == 0)
+            {
+               cout << "Non-Cartesian partitioning through METIS will be used."
+                    << endl;
+            }
+            pmesh = new ParMesh(MPI_COMM_WORLD, *mesh);
+         }
+         else
+         {
+            const bool hilbert = (sfc_partition != 2);
+            if (myid == 0)
+            {
+               cout << (hilbert ? "Hilbert" : "Morton")
+                    << " space-filling-curve partitioning will be used."
+                    << endl;
+            }
+            int *partitioning =
+               hydrodynamics::SpaceFillingCurvePartitioning(MPI_COMM_WORLD,
+                                                            *mesh, hilbert);
+            pmesh = new ParMesh(MPI_COMM_WORLD, *mesh, partitioning);
+            delete [] partitioning;
+         }
+      }
+      delete [] nxyz;
+      delete mesh;
+
+      // Refine the mesh further in parallel to increase the resolution.
+      for (int lev = 0; lev < rp_levels; lev++) { pmesh->UniformRefinement(); }
    }
-   int product = 1;
-   for (int d = 0; d < dim; d++) { product *= nxyz[d]; }
-   const bool cartesian_partitioning = (cxyz.Size()>0)?true:false;
-   if (product == num_tasks || cartesian_partitioning)
+
+   if (save_partition[0] != '\0')
    {
-      if (cartesian_partitioning)
+      hydrodynamics::SaveSnapshotMPIIO(save_partition, *pmesh, 0.0, 0, 0,
+                                       NULL, NULL);
+      if (mpi.Root())
       {
-         int cproduct = 1;
-         for (int d = 0; d < dim; d++) { cproduct *= cxyz[d]; }
-         MFEM_VERIFY(!cartesian_partitioning || cxyz.Size() == dim,
-                     "Expected " << mesh->SpaceDimension() << " integers with the "
-                     "option --cartesian-partitioning.");
-         MFEM_VERIFY(!cartesian_partitioning || num_tasks == cproduct,
-                     "Expected cartesian partitioning product to match number of ranks.");
+         cout << "Wrote the partitioned mesh to " << save_partition << endl;
       }
-      int *partitioning = cartesian_partitioning ?
-                          mesh->CartesianPartitioning(cxyz):
-                          mesh->CartesianPartitioning(nxyz);
-      pmesh = new ParMesh(MPI_COMM_WORLD, *mesh, partitioning);
-      delete [] partitioning;
    }
-   else
+
+   // 1D vs partial assembly sanity check.
+   if (p_assembly && dim == 1)
    {
-      if (myid == 0)
+      p_assembly = false;
+      if (mpi.Root())
       {
-         cout << "Non-Cartesian partitioning through METIS will be used.\n";
-#ifndef MFEM_USE_METIS
-         cout << "MFEM was built without METIS. "
-              << "Adjust the number of tasks to use a Cartesian split." << endl;
-#endif
+         cout << "Laghos does not support PA in 1D. Switching to FA." << endl;
       }
-#ifndef MFEM_USE_METIS
-      return 1;
-#endif
-      pmesh = new ParMesh(MPI_COMM_WORLD, *mesh);
    }
-   delete [] nxyz;
-   delete mesh;
-
-   // Refine the mesh further in parallel to increase the resolution.
-   for (int lev = 0; lev < rp_levels; lev++) { pmesh->UniformRefinement(); }
 
    int NE = pmesh->GetNE(), ne_min, ne_max;
    MPI_Reduce(&NE, &ne_min, 1, MPI_INT, MPI_MIN, 0, pmesh->GetComm());
@@ -451,8 +701,10 @@ int main(int argc, char *argv[])
          return 3;
    }
 
-   const HYPRE_Int glob_size_l2 = L2FESpace.GlobalTrueVSize();
-   const HYPRE_Int glob_size_h1 = H1FESpace.GlobalTrueVSize();
+   const long long glob_size_l2 =
+      hydrodynamics::GlobalCount(MPI_COMM_WORLD, L2FESpace.TrueVSize());
+   const long long glob_size_h1 =
+      hydrodynamics::GlobalCount(MPI_COMM_WORLD, H1FESpace.TrueVSize());
    if (mpi.Root())
    {
       cout << "Number of kinematic (position, velocity) dofs: "
@@ -472,7 +724,18 @@ int main(int argc, char *argv[])
    offset[1] = offset[0] + Vsize_h1;
    offset[2] = offset[1] + Vsize_h1;
    offset[3] = offset[2] + Vsize_l2;
+   // With -ft, the memory of S and of the zone data of the operator is
+   // allocated by zone_mem, which must outlive them.
+   first_touch = first_touch || huge_pages;
+   hydrodynamics::ZoneMemory zone_mem(huge_pages);
    BlockVector S(offset, Device::GetMemoryType());
+   if (first_touch)
+   {
+      Array<const FiniteElementSpace *> spaces(3);
+      spaces[0] = spaces[1] = &H1FESpace;
+      spaces[2] = &L2FESpace;
+      zone_mem.Place(S, offset, spaces);
+   }
 
    // Define GridFunction objects for the position, velocity and specific
    // internal energy. There is no function for the density, as we can always
@@ -485,8 +748,20 @@ int main(int argc, char *argv[])
 
    // Initialize x_gf using the starting mesh coordinates.
    pmesh->SetNodalGridFunction(&x_gf);
+   // When restarting, the initial setup below is done on the initial mesh, so
+   // that all quantities defined in the reference configuration (rho0, gamma,
+   // and the quadrature data of the hydro operator) are exactly recomputed.
+   if (restart)
+   {
+      MFEM_VERIFY(ckpt.x0.Size() == x_gf.Size() && ckpt.S.Size() == S.Size(),
+                  "The checkpoint does not match the discretization options.");
+      x_gf = ckpt.x0;
+   }
    // Sync the data location of x_gf with its base, S
    x_gf.SyncAliasMemory(S);
+   // The initial positions are stored in every checkpoint.
+   Vector x0;
+   if (checkpoint_steps > 0) { x0 = x_gf; }
 
    // Initialize the velocity.
    VectorFunctionCoefficient v_coeff(pmesh->Dimension(), v0);
@@ -558,15 +833,46 @@ int main(int argc, char *argv[])
                                                 visc, vorticity, p_assembly,
                                                 cg_tol, cg_max_iter, ftz_tol,
                                                 order_q);
+   if (node_local_exchange) { hydro.UseNodeLocalExchange(); }
+   if (first_touch) { hydro.PlaceZoneData(zone_mem); }
 
    socketstream vis_rho, vis_v, vis_e;
    char vishost[] = "localhost";
    int  visport   = 19916;
 
    ParGridFunction rho_gf;
-   if (visualization || visit) { hydro.ComputeDensity(rho_gf); }
-   const double energy_init = hydro.InternalEnergy(e_gf) +
-                              hydro.KineticEnergy(v_gf);
+   if (visualization || visit || shm_export) { hydro.ComputeDensity(rho_gf); }
+   double energy_diag[3];
+   hydro.EnergyDiagnostics(e_gf, v_gf, energy_diag);
+   const double energy_init = energy_diag[0] + energy_diag[1];
+
+   // Replace the initial state by the checkpointed one.
+   if (restart)
+   {
+      S.Vector::operator=(ckpt.S);
+      x_gf.SyncAliasMemory(S);
+      v_gf.SyncAliasMemory(S);
+      e_gf.SyncAliasMemory(S);
+      pmesh->NewNodes(x_gf, false);
+      hydro.SetInitialMeshSize(ckpt.h0);
+      hydrodynamics::TimingData &timer = hydro.GetTimingData();
+      for (int i = 0; i < 4; i++) { timer.rt_restart[i] = ckpt.timer_rt[i]; }
+      for (int i = 0; i < 5; i++)
+      {
+         timer.rt_restart_phase[i] = ckpt.phase_rt[i];
+      }
+      timer.rt_qdata_dt_est = ckpt.phase_rt[5];
+      timer.H1iter = ckpt.timer_cnt[0];
+      timer.L2iter = ckpt.timer_cnt[1];
+      timer.quad_tstep = ckpt.timer_cnt[2];
+      hydro.ResetQuadratureData();
+      if (visualization || visit || shm_export)
+      {
+         hydro.ComputeDensity(rho_gf);
+      }
+   }
+   const int ti_start = restart ? ckpt.ti : 0;
+   const double t_start = restart ? ckpt.t : 0.0;
 
    if (visualization)
    {
@@ -592,52 +898,112 @@ int main(int argc, char *argv[])
                                     "Specific Internal Energy", Wx, Wy, Ww, Wh);
    }
 
+   // Aggregated (N-to-M) VisIt output.
+   hydrodynamics::AggregatedVisItWriter *visit_aggr = nullptr;
+   if (visit && visit_group > 0)
+   {
+      visit_aggr = new hydrodynamics::AggregatedVisItWriter(*pmesh, basename,
+                                                            visit_group);
+   }
+
+   // Asynchronous output of the VisIt and -print files. The collective MPI-IO
+   // and the aggregated VisIt output are always written by the main thread.
+   hydrodynamics::AsyncWriter *async_writer = nullptr;
+   const bool async_visit = visit && !visit_aggr;
+   const bool print_compressed = !print_mpiio &&
+                                 (compress_abs_tol > 0.0 ||
+                                  compress_rel_tol > 0.0);
+   const bool async_print = gfprint && !print_mpiio && !print_compressed;
+   if (async_output > 0 && (async_visit || async_print))
+   {
+      async_writer = new hydrodynamics::AsyncWriter(*pmesh, H1FESpace,
+                                                    L2FESpace, basename,
+                                                    async_visit, async_print,
+                                                    async_output);
+   }
+
+   // The compressed output contains the positions and the fields of each
+   // output step; the local mesh of each rank is written once.
+   long long compressed_bytes = 0, uncompressed_bytes = 0;
+   if (gfprint && print_compressed)
+   {
+      std::ofstream mesh_ofs(hydrodynamics::RankFileName(
+                                std::string(basename) + "_lgz_mesh", myid));
+      mesh_ofs.precision(16);
+      pmesh->ParPrint(mesh_ofs);
+   }
+
+   // In-situ analysis: the shock radius for Sedov and the interface position
+   // between the heavy (rho0 = 2) and light (rho0 = 1) fluid for RT.
+   hydrodynamics::InSituAnalysis *insitu = nullptr;
+   if (insitu_bins > 0)
+   {
+      const double *shock_center = (problem == 1) ? blast_position : nullptr;
+      const double interface_rho0 = (problem == 7) ? 1.5 : 0.0;
+      insitu = new hydrodynamics::InSituAnalysis(hydro, *pmesh, basename,
+                                                 insitu_bins, shock_center,
+                                                 interface_rho0, restart);
+      if (!restart) { insitu->Compute(S, 0, 0.0); }
+   }
+
+   // Shared-memory export of the state, updated on the output steps.
+   hydrodynamics::SharedStateExporter *shm_exporter = nullptr;
+   if (shm_export)
+   {
+      shm_exporter = new hydrodynamics::SharedStateExporter(shm_name, *pmesh,
+                                                            x_gf, v_gf, e_gf,
+                                                            rho_gf);
+      shm_exporter->Update(ti_start, t_start, S, rho_gf);
+   }
+
    // Save data for VisIt visualization.
    VisItDataCollection visit_dc(basename, pmesh);
-   if (visit)
+   if (visit_aggr)
+   {
+      visit_aggr->Save(ti_start, t_start, *pmesh, rho_gf, v_gf, e_gf);
+   }
+   else if (visit && async_writer)
+   {
+      async_writer->Write(ti_start, t_start, x_gf, rho_gf, v_gf, e_gf);
+   }
+   else if (visit)
    {
       visit_dc.RegisterField("Density",  &rho_gf);
       visit_dc.RegisterField("Velocity", &v_gf);
       visit_dc.RegisterField("Specific Internal Energy", &e_gf);
-      visit_dc.SetCycle(0);
-      visit_dc.SetTime(0.0);
+      visit_dc.SetCycle(ti_start);
+      visit_dc.SetTime(t_start);
       visit_dc.Save();
    }
 
    // Perform time-integration (looping over the time iterations, ti, with a
    // time-step dt). The object oper is of type LagrangianHydroOperator that
    // defines the Mult() method that used by the time integrators.
+   // When restarting, the estimate is discarded, but it also brings the
+   // quadrature data to the state it had at the time of the checkpoint.
    ode_solver->Init(hydro);
    hydro.ResetTimeStepEstimate();
-   double t = 0.0, dt = hydro.GetTimeStepEstimate(S), t_old;
+   double t = t_start, dt = hydro.GetTimeStepEstimate(S), t_old;
    bool last_step = false;
    int steps = 0;
    BlockVector S_old(S);
    long mem=0, mmax=0, msum=0;
    int checks = 0;
-   //   const double internal_energy = hydro.InternalEnergy(e_gf);
-   //   const double kinetic_energy = hydro.KineticEnergy(v_gf);
-   //   if (mpi.Root())
-   //   {
-   //      cout << std::fixed;
-   //      cout << "step " << std::setw(5) << 0
-   //            << ",\tt = " << std::setw(5) << std::setprecision(4) << t
-   //            << ",\tdt = " << std::setw(5) << std::setprecision(6) << dt
-   //            << ",\t|IE| = " << std::setprecision(10) << std::scientific
-   //            << internal_energy
-   //            << ",\t|KE| = " << std::setprecision(10) << std::scientific
-   //            << kinetic_energy
-   //            << ",\t|E| = " << std::setprecision(10) << std::scientific
-   //            << kinetic_energy+internal_energy;
-   //      cout << std::fixed;
-   //      if (mem_usage)
-   //      {
-   //         cout << ", mem: " << mmax << "/" << msum << " MB";
-   //      }
-   //      cout << endl;
-   //   }
-   for (int ti = 1; !last_step; ti++)
+   double energy_drift = 0.0;
+   if (restart)
+   {
+      dt = ckpt.dt;
+      steps = ckpt.steps;
+      checks = ckpt.checks;
+      energy_drift = ckpt.energy_drift;
+   }
+   hydrodynamics::TimingData &phase_timer = hydro.GetTimingData();
+   const bool trace = trace_file[0] != '\0';
+   if (trace) { hydrodynamics::TraceInit(pmesh->GetComm(), trace_events); }
+   for (int ti = ti_start + 1; !last_step; ti++)
    {
+      LAGHOS_TRACE("step");
+      phase_timer.sw_step.Start();
       if (t + dt >= t_final)
       {
          dt = t_final - t;
@@ -653,8 +1019,32 @@ int main(int argc, char *argv[])
       ode_solver->Step(S, t, dt);
       steps++;
 
-      // Adaptive time step control.
-      const double dt_est = hydro.GetTimeStepEstimate(S);
+      // Ensure the sub-vectors x_gf, v_gf, and e_gf know the location of the
+      // data in S. This operation simply updates the Memory validity flags of
+      // the sub-vectors to match those of S.
+      x_gf.SyncAliasMemory(S);
+      v_gf.SyncAliasMemory(S);
+      e_gf.SyncAliasMemory(S);
+
+      // Adaptive time step control. The global reduction of the time step
+      // estimate is nonblocking, and it also carries the local |e|^2 needed
+      // on output and check steps, so no separate collective is required.
+      // With energy monitoring, the fused energy diagnostics {IE, KE, |e|^2}
+      // are computed every step and bundled in the same message.
+      const bool output_step = last_step || (ti % vis_steps) == 0;
+      double diag[3] = { 0.0, 0.0, 0.0 };
+      if (energy_monitor) { hydro.LocalEnergyDiagnostics(e_gf, v_gf, diag); }
+      else if (output_step || check) { diag[2] = e_gf * e_gf; }
+      hydro.StartTimeStepEstimate(S, diag, 3);
+
+      // Make sure that the mesh corresponds to the new solution state. This is
+      // needed, because some time integrators use different S-type vectors
+      // and the oper object might have redirected the mesh positions to those.
+      // This local work overlaps the above reduction.
+      pmesh->NewNodes(x_gf, false);
+
+      const double dt_est = hydro.FinishTimeStepEstimate(diag);
+      const double e_norm2 = diag[2];
       if (dt_est < dt)
       {
          // Repeat (solve again) with a decreased time step - decrease of the
@@ -667,34 +1057,30 @@ int main(int argc, char *argv[])
          hydro.ResetQuadratureData();
          if (mpi.Root()) { cout << "Repeating step " << ti << endl; }
          if (steps < max_tsteps) { last_step = false; }
+         phase_timer.sw_step.Stop();
          ti--; continue;
       }
       else if (dt_est > 1.25 * dt) { dt *= 1.02; }
 
-      // Ensure the sub-vectors x_gf, v_gf, and e_gf know the location of the
-      // data in S. This operation simply updates the Memory validity flags of
-      // the sub-vectors to match those of S.
-      x_gf.SyncAliasMemory(S);
-      v_gf.SyncAliasMemory(S);
-      e_gf.SyncAliasMemory(S);
+      if (energy_monitor)
+      {
+         const double energy = diag[0] + diag[1];
+         energy_drift = fmax(energy_drift, fabs(energy - energy_init));
+      }
 
-      // Make sure that the mesh corresponds to the new solution state. This is
-      // needed, because some time integrators use different S-type vectors
-      // and the oper object might have redirected the mesh positions to those.
-      pmesh->NewNodes(x_gf, false);
+      if (insitu) { insitu->Compute(S, ti, t); }
 
-      if (last_step || (ti % vis_steps) == 0)
+      if (output_step)
       {
-         double lnorm = e_gf * e_gf, norm;
-         MPI_Allreduce(&lnorm, &norm, 1, MPI_DOUBLE, MPI_SUM, pmesh->GetComm());
+         LAGHOS_TRACE("output");
+         phase_timer.sw_output.Start();
+         const double norm = e_norm2;
          if (mem_usage)
          {
             mem = GetMaxRssMB();
             MPI_Reduce(&mem, &mmax, 1, MPI_LONG, MPI_MAX, 0, pmesh->GetComm());
             MPI_Reduce(&mem, &msum, 1, MPI_LONG, MPI_SUM, 0, pmesh->GetComm());
          }
-         // const double internal_energy = hydro.InternalEnergy(e_gf);
-         // const double kinetic_energy = hydro.KineticEnergy(v_gf);
          if (mpi.Root())
          {
             const double sqrt_norm = sqrt(norm);
@@ -705,12 +1091,13 @@ int main(int argc, char *argv[])
                  << ",\tdt = " << std::setw(5) << std::setprecision(6) << dt
                  << ",\t|e| = " << std::setprecision(10) << std::scientific
                  << sqrt_norm;
-            //  << ",\t|IE| = " << std::setprecision(10) << std::scientific
-            //  << internal_energy
-            //   << ",\t|KE| = " << std::setprecision(10) << std::scientific
-            //  << kinetic_energy
-            //   << ",\t|E| = " << std::setprecision(10) << std::scientific
-            //  << kinetic_energy+internal_energy;
+            if (energy_monitor)
+            {
+               cout << ",\t|IE| = " << std::setprecision(10) << diag[0]
+                    << ",\t|KE| = " << std::setprecision(10) << diag[1]
+                    << ",\t|E| = " << std::setprecision(10)
+                    << diag[0] + diag[1];
+            }
             cout << std::fixed;
             if (mem_usage)
             {
@@ -723,7 +1110,10 @@ int main(int argc, char *argv[])
          // another set of GLVis connections (one from each rank):
          MPI_Barrier(pmesh->GetComm());
 
-         if (visualization || visit || gfprint) { hydro.ComputeDensity(rho_gf); }
+         if (visualization || visit || gfprint || shm_export)
+         {
+            hydro.ComputeDensity(rho_gf);
+         }
          if (visualization)
          {
             int Wx = 0, Wy = 0; // window position
@@ -744,14 +1134,72 @@ int main(int argc, char *argv[])
             Wx += offx;
          }
 
-         if (visit)
+         if (async_writer)
+         {
+            async_writer->Write(ti, t, x_gf, rho_gf, v_gf, e_gf);
+         }
+         if (visit_aggr)
+         {
+            visit_aggr->Save(ti, t, *pmesh, rho_gf, v_gf, e_gf);
+         }
+         else if (visit && !async_writer)
          {
             visit_dc.SetCycle(ti);
             visit_dc.SetTime(t);
             visit_dc.Save();
          }
 
-         if (gfprint)
+         if (shm_exporter) { shm_exporter->Update(ti, t, S, rho_gf); }
+
+         if (gfprint && print_mpiio)
+         {
+            std::ostringstream snap_name;
+            snap_name << basename << "_" << ti << ".lgs";
+            const char *names[3] = { "rho", "v", "e" };
+            const ParGridFunction *fields[3] = { &rho_gf, &v_gf, &e_gf };
+            hydrodynamics::SaveSnapshotMPIIO(snap_name.str(), *pmesh, t, ti,
+                                             3, names, fields);
+         }
+         else if (gfprint && print_compressed)
+         {
+            std::ostringstream prefix;
+            prefix << basename << "_" << ti << ".lgz";
+            const char *names[4] = { "x", "rho", "v", "e" };
+            const ParGridFunction *fields[4] = { &x_gf, &rho_gf, &v_gf, &e_gf };
+            compressed_bytes +=
+               hydrodynamics::SaveCompressed(prefix.str(), *pmesh, t, ti,
+                                             compress_abs_tol,
+                                             compress_rel_tol, 4, names,
+                                             fields);
+            for (int f = 0; compress_check && f < 4; f++)
+            {
+               // The tolerance of the field is at most abs_tol, or else
+               // rel_tol times its maximum magnitude.
+               double bound = compress_abs_tol;
+               if (bound <= 0.0)
+               {
+                  double fmax = fields[f]->Normlinf();
+                  MPI_Allreduce(MPI_IN_PLACE, &fmax, 1, MPI_DOUBLE, MPI_MAX,
+                                pmesh->GetComm());
+                  bound = compress_rel_tol * fmax;
+               }
+               ParGridFunction *gf =
+                  hydrodynamics::LoadCompressed(prefix.str(), *pmesh,
+                                                names[f]);
+               *gf -= *fields[f];
+               double err = gf->Normlinf();
+               delete gf;
+               MPI_Allreduce(MPI_IN_PLACE, &err, 1, MPI_DOUBLE, MPI_MAX,
+                             pmesh->GetComm());
+               MFEM_VERIFY(err <= bound * (1.0 + 1e-12), "Compressed field "
+                           << names[f] << " at step " << ti << ": error "
+                           << err << " above the tolerance " << bound);
+            }
+            uncompressed_bytes += sizeof(double) *
+                                  (x_gf.Size() + rho_gf.Size() +
+                                   v_gf.Size() + e_gf.Size());
+         }
+         else if (gfprint && !async_writer)
          {
             std::ostringstream mesh_name, rho_name, v_name, e_name;
             mesh_name << basename << "_" << ti << "_mesh";
@@ -779,14 +1227,13 @@ int main(int argc, char *argv[])
             e_gf.SaveAsOne(e_ofs);
             e_ofs.close();
          }
+         phase_timer.sw_output.Stop();
       }
 
       // Problems checks
       if (check)
       {
-         double lnorm = e_gf * e_gf, norm;
-         MPI_Allreduce(&lnorm, &norm, 1, MPI_DOUBLE, MPI_SUM, pmesh->GetComm());
-         const double e_norm = sqrt(norm);
+         const double e_norm = sqrt(e_norm2);
          MFEM_VERIFY(rs_levels==0 && rp_levels==0, "check: rs, rp");
          MFEM_VERIFY(order_v==2, "check: order_v");
          MFEM_VERIFY(order_e==1, "check: order_e");
@@ -797,9 +1244,55 @@ int main(int argc, char *argv[])
          MFEM_VERIFY(dim==2 || dim==3, "check: dimension");
          Checks(dim, ti, e_norm, checks);
       }
+
+      // Periodic checkpoint, written by each rank to its own file.
+      if (checkpoint_steps > 0 && (ti % checkpoint_steps) == 0)
+      {
+         LAGHOS_TRACE("checkpoint");
+         const hydrodynamics::TimingData &timer = hydro.GetTimingData();
+         ckpt.ti = ti;
+         ckpt.steps = steps;
+         ckpt.checks = checks;
+         ckpt.t = t;
+         ckpt.dt = dt;
+         ckpt.h0 = hydro.GetInitialMeshSize();
+         ckpt.energy_drift = energy_drift;
+         ckpt.timer_rt[0] = timer.rt_restart[0] + timer.sw_cgH1.RealTime();
+         ckpt.timer_rt[1] = timer.rt_restart[1] + timer.sw_cgL2.RealTime();
+         ckpt.timer_rt[2] = timer.rt_restart[2] + timer.sw_force.RealTime();
+         ckpt.timer_rt[3] = timer.rt_restart[3] + timer.sw_qdata.RealTime();
+         StopWatch *phase_sw[5] =
+         {
+            &timer.sw_step, &timer.sw_stage, &timer.sw_dt_est, &timer.sw_halo,
+            &timer.sw_output
+         };
+         for (int i = 0; i < 5; i++)
+         {
+            ckpt.phase_rt[i] = timer.rt_restart_phase[i] +
+                               phase_sw[i]->RealTime();
+         }
+         ckpt.phase_rt[5] = timer.rt_qdata_dt_est;
+         ckpt.timer_cnt[0] = timer.H1iter;
+         ckpt.timer_cnt[1] = timer.L2iter;
+         ckpt.timer_cnt[2] = timer.quad_tstep;
+         ckpt.S.MakeRef(S, 0, S.Size());
+         ckpt.x0.MakeRef(x0, 0, x0.Size());
+         const std::string prefix =
+            hydrodynamics::CheckpointPrefix(basename, ti);
+         hydrodynamics::SaveCheckpoint(prefix, *pmesh, ckpt);
+         if (mpi.Root()) { cout << "Checkpoint " << prefix << endl; }
+      }
+      phase_timer.sw_step.Stop();
    }
    MFEM_VERIFY(!check || checks == 2, "Check error!");
 
+   // Wait for the queued output to be written.
+   delete async_writer;
+   delete visit_aggr;
+   delete insitu;
+   delete shm_exporter;
+   if (trace) { hydrodynamics::TraceWrite(trace_file); }
+
    switch (ode_solver_type)
    {
       case 2: steps *= 2; break;
@@ -810,6 +1303,15 @@ int main(int argc, char *argv[])
    }
 
    hydro.PrintTimingData(mpi.Root(), steps, fom);
+   if (phase_timers) { hydro.PrintPhaseTimers(mpi.Root()); }
+   if (perf_counters)
+   {
+      hydrodynamics::PerfPrint(pmesh->GetComm(), mpi.Root());
+   }
+   if (roofline)
+   {
+      hydrodynamics::RooflinePrint(pmesh->GetComm(), mpi.Root());
+   }
 
    if (mem_usage)
    {
@@ -818,13 +1320,32 @@ int main(int argc, char *argv[])
       MPI_Reduce(&mem, &msum, 1, MPI_LONG, MPI_SUM, 0, pmesh->GetComm());
    }
 
-   const double energy_final = hydro.InternalEnergy(e_gf) +
-                               hydro.KineticEnergy(v_gf);
+   if (gfprint && print_compressed)
+   {
+      MPI_Allreduce(MPI_IN_PLACE, &compressed_bytes, 1, MPI_LONG_LONG,
+                    MPI_SUM, pmesh->GetComm());
+      MPI_Allreduce(MPI_IN_PLACE, &uncompressed_bytes, 1, MPI_LONG_LONG,
+                    MPI_SUM, pmesh->GetComm());
+   }
+
+   hydro.EnergyDiagnostics(e_gf, v_gf, energy_diag);
+   const double energy_final = energy_diag[0] + energy_diag[1];
    if (mpi.Root())
    {
       cout << endl;
       cout << "Energy  diff: " << std::scientific << std::setprecision(2)
            << fabs(energy_init - energy_final) << endl;
+      if (energy_monitor)
+      {
+         cout << "Max energy drift: " << std::scientific
+              << std::setprecision(2) << energy_drift << endl;
+      }
+      if (gfprint && print_compressed && compressed_bytes > 0)
+      {
+         cout << "Compressed output: " << compressed_bytes << " bytes, "
+              << "ratio " << std::fixed << std::setprecision(2)
+              << double(uncompressed_bytes) / compressed_bytes << endl;
+      }
       if (mem_usage)
       {
          cout << "Maximum memory resident set size: "
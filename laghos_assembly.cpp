@@ -15,6 +15,10 @@
 // testbed platforms, in support of the nation's exascale computing imperative.
 
 #include "laghos_assembly.hpp"
+#include "laghos_halo.hpp"
+#include "laghos_memory.hpp"
+#include "laghos_perf.hpp"
+#include "laghos_trace.hpp"
 #include <unordered_map>
 
 namespace mfem
@@ -85,9 +89,12 @@ MassPAOperator::MassPAOperator(ParFiniteElementSpace &pfes,
    dim(pfes.GetMesh()->Dimension()),
    NE(pfes.GetMesh()->GetNE()),
    vsize(pfes.GetVSize()),
+   D1D(pfes.GetFE(0)->GetOrder() + 1),
+   Q1D(IntRules.Get(Geometry::SEGMENT, ir.GetOrder()).GetNPoints()),
    pabf(&pfes),
    ess_tdofs_count(0),
-   ess_tdofs(0)
+   ess_tdofs(0),
+   P(NULL)
 {
    pabf.SetAssemblyLevel(AssemblyLevel::PARTIAL);
    pabf.AddDomainIntegrator(new mfem::MassIntegrator(Q, &ir));
@@ -114,9 +121,33 @@ void MassPAOperator::EliminateRHS(Vector &b) const
    if (ess_tdofs_count > 0) { b.SetSubVector(ess_tdofs, 0.0); }
 }
 
+void MassPAOperator::SetProlongation(const Operator *prolongation)
+{
+   P = prolongation;
+   xl.SetSize(vsize);
+   yl.SetSize(vsize);
+}
+
+void MassPAOperator::MultFull(const Vector &x, Vector &y) const
+{
+   LAGHOS_TRACE("mass");
+   if (!P)
+   {
+      PerfScope perf(PERF_MASS, NE, MassCost(dim, D1D, Q1D));
+      mass->Mult(x, y);
+      return;
+   }
+   P->Mult(x, xl);
+   {
+      PerfScope perf(PERF_MASS, NE, MassCost(dim, D1D, Q1D));
+      pabf.Mult(xl, yl);
+   }
+   P->MultTranspose(yl, y);
+}
+
 void MassPAOperator::Mult(const Vector &x, Vector &y) const
 {
-   mass->Mult(x, y);
+   MultFull(x, y);
    if (ess_tdofs_count > 0) { y.SetSubVector(ess_tdofs, 0.0); }
 }
 
@@ -140,10 +171,69 @@ ForcePAOperator::ForcePAOperator(const QuadratureData &qdata,
    L2sz(L2.GetFE(0)->GetDof() * NE),
    L2D2Q(&L2.GetFE(0)->GetDofToQuad(ir, DofToQuad::TENSOR)),
    H1D2Q(&H1.GetFE(0)->GetDofToQuad(ir, DofToQuad::TENSOR)),
-   X(L2sz), Y(H1sz) { }
+   X(L2sz), Y(H1sz), gc(NULL), nlx(NULL)
+{
+   if (H1.GetNRanks() == 1 || !H1.Conforming() ||
+       Device::Allows(Backend::DEVICE_MASK)) { return; }
+   gc = &h1.GroupComm();
+
+   // Scalar dofs in the groups of shared entities (group 0 is the local one).
+   const int ndofs = H1.GetNDofs(), nd = H1.GetFE(0)->GetDof();
+   const Table &group_ldof = gc->GroupLDofTable();
+   Array<int> shared_index(ndofs);
+   shared_index = -1;
+   for (int g = 1; g < group_ldof.Size(); g++)
+   {
+      for (int j = 0; j < group_ldof.RowSize(g); j++)
+      {
+         const int d = H1.VDofToDof(group_ldof.GetRow(g)[j]);
+         if (shared_index[d] < 0)
+         {
+            shared_index[d] = shared_dofs.Size();
+            shared_dofs.Append(d);
+         }
+      }
+   }
+
+   // Zones with shared dofs, and the E-vector entries of the shared dofs in
+   // increasing order of zones, as summed by H1R->MultTranspose().
+   const TensorBasisElement *tfe =
+      dynamic_cast<const TensorBasisElement *>(H1.GetFE(0));
+   MFEM_VERIFY(tfe, "The H1 space must use tensor product elements.");
+   const Array<int> &dof_map = tfe->GetDofMap();
+   Array<int> dofs;
+   shared_I.SetSize(shared_dofs.Size() + 1);
+   shared_I = 0;
+   for (int e = 0; e < NE; e++)
+   {
+      H1.GetElementDofs(e, dofs);
+      bool bdr = false;
+      for (int j = 0; j < nd; j++)
+      {
+         const int d = shared_index[dofs[j]];
+         if (d >= 0) { shared_I[d + 1]++; bdr = true; }
+      }
+      if (bdr) { bdr_elems.Append(e); }
+      else { int_elems.Append(e); }
+   }
+   shared_I.PartialSum();
+   shared_J.SetSize(shared_I.Last());
+   Array<int> pos(shared_I);
+   for (int i = 0; i < bdr_elems.Size(); i++)
+   {
+      const int e = bdr_elems[i];
+      H1.GetElementDofs(e, dofs);
+      for (int j = 0; j < nd; j++)
+      {
+         const int d = dofs[dof_map.Size() ? dof_map[j] : j];
+         const int s = shared_index[d];
+         if (s >= 0) { shared_J[pos[s]++] = j + nd * H1.GetVDim() * e; }
+      }
+   }
+}
 
 template<int DIM, int D1D, int Q1D, int L1D, int NBZ = 1> static
-void ForceMult2D(const int NE,
+void ForceMult2D(const int NE, const int ne, const int *elems,
                  const Array<double> &B_,
                  const Array<double> &Bt_,
                  const Array<double> &Gt_,
@@ -160,8 +250,9 @@ void ForceMult2D(const int NE,
    const double eps2 = eps1*eps1;
    auto velocity = Reshape(y.Write(), D1D, D1D, DIM, NE);
 
-   MFEM_FORALL_2D(e, NE, Q1D, Q1D, 1,
+   MFEM_FORALL_2D(ei, ne, Q1D, Q1D, 1,
    {
+      const int e = elems ? elems[ei] : ei;
       const int z = MFEM_THREAD_ID(z);
 
       MFEM_SHARED double B[Q1D][L1D];
@@ -294,7 +385,7 @@ void ForceMult2D(const int NE,
 }
 
 template<int DIM, int D1D, int Q1D, int L1D> static
-void ForceMult3D(const int NE,
+void ForceMult3D(const int NE, const int ne, const int *elems,
                  const Array<double> &B_,
                  const Array<double> &Bt_,
                  const Array<double> &Gt_,
@@ -311,8 +402,9 @@ void ForceMult3D(const int NE,
    const double eps2 = eps1*eps1;
    auto velocity = Reshape(y.Write(), D1D, D1D, D1D, DIM, NE);
 
-   MFEM_FORALL_3D(e, NE, Q1D, Q1D, Q1D,
+   MFEM_FORALL_3D(ei, ne, Q1D, Q1D, Q1D,
    {
+      const int e = elems ? elems[ei] : ei;
       const int z = MFEM_THREAD_ID(z);
 
       MFEM_SHARED double B[Q1D][L1D];
@@ -513,7 +605,7 @@ void ForceMult3D(const int NE,
    });
 }
 
-typedef void (*fForceMult)(const int E,
+typedef void (*fForceMult)(const int E, const int ne, const int *elems,
                            const Array<double> &B,
                            const Array<double> &Bt,
                            const Array<double> &Gt,
@@ -527,7 +619,8 @@ static void ForceMult(const int DIM, const int D1D, const int Q1D,
                       const Array<double> &Gt,
                       const DenseTensor &stressJinvT,
                       const Vector &e,
-                      Vector &v)
+                      Vector &v,
+                      const Array<int> *elems = NULL)
 {
    MFEM_VERIFY(D1D==H1D, "D1D!=H1D");
    MFEM_VERIFY(L1D==D1D-1,"L1D!=D1D-1");
@@ -548,19 +641,83 @@ static void ForceMult(const int DIM, const int D1D, const int Q1D,
       mfem::out << "Unknown kernel 0x" << std::hex << id << std::endl;
       MFEM_ABORT("Unknown kernel");
    }
-   call[id](NE, B, Bt, Gt, stressJinvT, e, v);
+   // Without a list of zones, all the zones are computed.
+   const int ne = elems ? elems->Size() : NE;
+   const int *E = elems ? elems->Read() : NULL;
+   call[id](NE, ne, E, B, Bt, Gt, stressJinvT, e, v);
 }
 
 void ForcePAOperator::Mult(const Vector &x, Vector &y) const
 {
+   LAGHOS_TRACE("force");
    if (L2R) { L2R->Mult(x, X); }
    else { X = x; }
-   ForceMult(dim, D1D, Q1D, L1D, D1D, NE,
-             L2D2Q->B, H1D2Q->Bt, H1D2Q->Gt,
-             qdata.stressJinvT, X, Y);
+   {
+      PerfScope perf(PERF_FORCE, NE, ForceCost(dim, D1D, Q1D, L1D));
+      ForceMult(dim, D1D, Q1D, L1D, D1D, NE,
+                L2D2Q->B, H1D2Q->Bt, H1D2Q->Gt,
+                qdata.stressJinvT, X, Y);
+   }
+   H1R->MultTranspose(Y, y);
+}
+
+void ForcePAOperator::PlaceZoneData(ZoneMemory &mem)
+{
+   mem.Place(X, NE);
+   mem.Place(Y, NE);
+}
+
+void ForcePAOperator::MultReduced(const Vector &x, Vector &y) const
+{
+   MFEM_VERIFY(gc, "The overlapped exchange is not available.");
+   LAGHOS_TRACE("force");
+   if (L2R) { L2R->Mult(x, X); }
+   else { X = x; }
+   {
+      PerfScope perf(PERF_FORCE, bdr_elems.Size(),
+                     ForceCost(dim, D1D, Q1D, L1D));
+      ForceMult(dim, D1D, Q1D, L1D, D1D, NE,
+                L2D2Q->B, H1D2Q->Bt, H1D2Q->Gt,
+                qdata.stressJinvT, X, Y, &bdr_elems);
+   }
+
+   // Sum the shared dofs of the boundary zones and start their exchange.
+   const int ndofs = H1.GetNDofs(), vdim = H1.GetVDim();
+   const int nd = H1.GetFE(0)->GetDof();
+   const double *Yd = Y.HostRead();
+   double *yd = y.HostWrite();
+   for (int s = 0; s < shared_dofs.Size(); s++)
+   {
+      for (int c = 0; c < vdim; c++)
+      {
+         double sum = 0.0;
+         for (int k = shared_I[s]; k < shared_I[s+1]; k++)
+         {
+            sum += Yd[shared_J[k] + c * nd];
+         }
+         yd[shared_dofs[s] + c * ndofs] = sum;
+      }
+   }
+   if (nlx) { nlx->ReduceBegin(yd); }
+   else { gc->ReduceBegin(yd); }
+
+   {
+      PerfScope perf(PERF_FORCE, int_elems.Size(),
+                     ForceCost(dim, D1D, Q1D, L1D));
+      ForceMult(dim, D1D, Q1D, L1D, D1D, NE,
+                L2D2Q->B, H1D2Q->Bt, H1D2Q->Gt,
+                qdata.stressJinvT, X, Y, &int_elems);
+   }
    H1R->MultTranspose(Y, y);
 }
 
+void ForcePAOperator::MultReducedEnd(Vector &y) const
+{
+   LAGHOS_TRACE("force_halo_wait");
+   if (nlx) { nlx->ReduceEnd(y.HostReadWrite()); }
+   else { gc->ReduceEnd(y.HostReadWrite(), 0, GroupCommunicator::Sum<double>); }
+}
+
 template<int DIM, int D1D, int Q1D, int L1D, int NBZ = 1> static
 void ForceMultTranspose2D(const int NE,
                           const Array<double> &Bt_,
@@ -958,10 +1115,15 @@ static void ForceMultTranspose(const int DIM, const int D1D, const int Q1D,
 
 void ForcePAOperator::MultTranspose(const Vector &x, Vector &y) const
 {
+   LAGHOS_TRACE("force_transpose");
    H1R->Mult(x, Y);
-   ForceMultTranspose(dim, D1D, Q1D, L1D, NE,
-                      L2D2Q->Bt, H1D2Q->B, H1D2Q->G,
-                      qdata.stressJinvT, Y, X);
+   {
+      PerfScope perf(PERF_FORCE_TRANSPOSE, NE,
+                     ForceTransposeCost(dim, D1D, Q1D, L1D));
+      ForceMultTranspose(dim, D1D, Q1D, L1D, NE,
+                         L2D2Q->Bt, H1D2Q->B, H1D2Q->G,
+                         qdata.stressJinvT, Y, X);
+   }
    if (L2R) { L2R->MultTranspose(X, y); }
    else { y = X; }
 }
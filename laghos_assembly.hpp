@@ -21,12 +21,31 @@
 #include "general/forall.hpp"
 #include "linalg/dtensor.hpp"
 
+// Host-side loops over the zones are threaded with OpenMP when it is enabled.
+// Loops that evaluate MFEM element objects (finite elements, transformations,
+// integrators) use LAGHOS_OMP_FE, which additionally requires MFEM to be built
+// with MFEM_THREAD_SAFE, i.e., without shared scratch data in these objects.
+#define LAGHOS_PRAGMA(...) _Pragma(#__VA_ARGS__)
+#ifdef _OPENMP
+#define LAGHOS_OMP(...) LAGHOS_PRAGMA(omp __VA_ARGS__)
+#else
+#define LAGHOS_OMP(...)
+#endif
+#if defined(_OPENMP) && defined(MFEM_THREAD_SAFE)
+#define LAGHOS_OMP_FE(...) LAGHOS_PRAGMA(omp __VA_ARGS__)
+#else
+#define LAGHOS_OMP_FE(...)
+#endif
+
 namespace mfem
 {
 
 namespace hydrodynamics
 {
 
+class ZoneMemory;
+class NodeLocalProlongation;
+
 // Container for all data needed at quadrature points.
 struct QuadratureData
 {
@@ -102,6 +121,14 @@ private:
    const int D1D, Q1D, L1D, H1sz, L2sz;
    const DofToQuad *L2D2Q, *H1D2Q;
    mutable Vector X, Y;
+   // Overlap of the exchange of the shared H1 dofs with the interior zones:
+   // the zones that contain shared dofs, the other zones, and for each shared
+   // scalar dof, the E-vector entries (of the first component) summed into it.
+   const GroupCommunicator *gc;
+   // Optional node-local shared-memory summation, replacing gc.
+   const NodeLocalProlongation *nlx;
+   Array<int> bdr_elems, int_elems;
+   Array<int> shared_dofs, shared_I, shared_J;
 public:
    ForcePAOperator(const QuadratureData&,
                    ParFiniteElementSpace&,
@@ -109,6 +136,21 @@ public:
                    const IntegrationRule&);
    virtual void Mult(const Vector&, Vector&) const;
    virtual void MultTranspose(const Vector&, Vector&) const;
+   // Moves the E-vectors into NUMA first-touched memory.
+   void PlaceZoneData(ZoneMemory &mem);
+
+   // True when MultReduced() can be used: in parallel, on the host.
+   bool ReducesSharedDofs() const { return gc != NULL; }
+   // Same as Mult(), followed by the summation of the shared dofs of y on the
+   // ranks that own them, so that the owned true dofs of P^T y are the owned
+   // entries of y. The zones with shared dofs are computed first, then their
+   // exchange is started before the interior zones. MultReducedEnd() waits
+   // for the exchange, so that the caller can time the wait separately.
+   void MultReduced(const Vector &x, Vector &y) const;
+   void MultReducedEnd(Vector &y) const;
+   // Sums the shared dofs in MultReduced() through the node-local exchange of
+   // the given prolongation of H1 instead of messages.
+   void SetNodeLocalExchange(const NodeLocalProlongation *P) { nlx = P; }
 };
 
 // Performs partial assembly for the velocity mass matrix.
@@ -117,14 +159,20 @@ class MassPAOperator : public Operator
 private:
    const MPI_Comm comm;
    const int dim, NE, vsize;
+   // Numbers of 1D dofs and quadrature points, for the roofline model.
+   const int D1D, Q1D;
    ParBilinearForm pabf;
    int ess_tdofs_count;
    Array<int> ess_tdofs;
    OperatorPtr mass;
+   // Optional replacement of the prolongation of the space in P^T A P.
+   const Operator *P;
+   mutable Vector xl, yl;
 public:
    MassPAOperator(ParFiniteElementSpace&, const IntegrationRule&, Coefficient&);
    virtual void Mult(const Vector&, Vector&) const;
-   void MultFull(const Vector &x, Vector &y) const { mass->Mult(x, y); }
+   void MultFull(const Vector &x, Vector &y) const;
+   void SetProlongation(const Operator *prolongation);
    virtual void SetEssentialTrueDofs(Array<int>&);
    virtual void EliminateRHS(Vector&) const;
    const ParBilinearForm &GetBF() const { return pabf; }
@@ -0,0 +1,244 @@
+// Copyright (c) 2017, Lawrence Livermore National Security, LLC. Produced at
+// the Lawrence Livermore National Laboratory. LLNL-CODE-734707. All Rights
+// reserved. See files LICENSE and NOTICE for details.
+//
+// This file is part of CEED, a collection of benchmarks, miniapps, software
+// libraries and APIs for efficient high-order finite element and spectral
+// element discretizations for exascale applications. For more information and
+// source code availability see http://github.com/ceed.
+//
+// The CEED research is supported by the Exascale Computing Project 17-SC-20-SC,
+// a collaborative effort of two U.S. Department of Energy organizations (Office
+// of Science and the National Nuclear Security Administration) responsible for
+// the planning and preparation of a capable exascale ecosystem, including
+// software, applications, hardware, advanced system engineering and early
+// testbed platforms, in support of the nation's exascale computing imperative.
+
+#include "laghos_halo.hpp"
+#include <algorithm>
+#include <map>
+#include <vector>
+
+#ifdef MFEM_USE_MPI
+
+namespace mfem
+{
+
+namespace hydrodynamics
+{
+
+NodeLocalProlongation::NodeLocalProlongation(ParFiniteElementSpace &pfes)
+   : Operator(pfes.GetVSize(), pfes.GetTrueVSize()),
+     offnode(pfes.GetParMesh()->gtopo), work(pfes.GetVSize()), parity(0)
+{
+   MFEM_VERIFY(pfes.Conforming(), "A conforming space is required.");
+   ParMesh *pmesh = pfes.GetParMesh();
+   const int myid = pmesh->GetMyRank();
+   MPI_Comm_split_type(pmesh->GetComm(), MPI_COMM_TYPE_SHARED, myid,
+                       MPI_INFO_NULL, &node_comm);
+   int node_size;
+   MPI_Comm_size(node_comm, &node_size);
+   MPI_Comm_rank(node_comm, &node_rank);
+   Array<int> node_ranks(node_size);
+   MPI_Allgather(&myid, 1, MPI_INT, node_ranks.GetData(), 1, MPI_INT,
+                 node_comm);
+   std::map<int, int> node_index;
+   for (int q = 0; q < node_size; q++) { node_index[node_ranks[q]] = q; }
+
+   const int ndofs = pfes.GetVSize();
+   ltdof.SetSize(ndofs);
+   for (int i = 0; i < ndofs; i++) { ltdof[i] = pfes.GetLocalTDofNumber(i); }
+
+   // Split the groups into the ones within the node, published in the window,
+   // and the other ones, exchanged by offnode. A group is identified across
+   // the ranks by its sorted list of ranks.
+   GroupTopology &gtopo = pmesh->gtopo;
+   const Table &group_ldof = pfes.GroupComm().GroupLDofTable();
+   const int ngroups = gtopo.NGroups();
+   std::vector<std::vector<int> > keys(ngroups);
+   Array<int> pub_offset(ngroups);
+   pub_offset = -1;
+   Array<int> descr;
+   Table &off_ldof = offnode.GroupLDofTable();
+   off_ldof.MakeI(ngroups);
+   for (int g = 1; g < ngroups; g++)
+   {
+      bool local = true;
+      for (int j = 0; j < gtopo.GetGroupSize(g); j++)
+      {
+         const int r = gtopo.GetNeighborRank(gtopo.GetGroup(g)[j]);
+         keys[g].push_back(r);
+         if (node_index.find(r) == node_index.end()) { local = false; }
+      }
+      std::sort(keys[g].begin(), keys[g].end());
+      if (!local)
+      {
+         off_ldof.AddColumnsInRow(g, group_ldof.RowSize(g));
+         continue;
+      }
+      pub_offset[g] = pub_ldofs.Size();
+      pub_ldofs.Append(group_ldof.GetRow(g), group_ldof.RowSize(g));
+      descr.Append(static_cast<int>(keys[g].size()));
+      for (size_t j = 0; j < keys[g].size(); j++) { descr.Append(keys[g][j]); }
+      descr.Append(pub_offset[g]);
+      descr.Append(group_ldof.RowSize(g));
+   }
+   off_ldof.MakeJ();
+   for (int g = 1; g < ngroups; g++)
+   {
+      if (pub_offset[g] >= 0) { continue; }
+      off_ldof.AddConnections(g, group_ldof.GetRow(g), group_ldof.RowSize(g));
+   }
+   off_ldof.ShiftUpI();
+   offnode.Finalize();
+
+   // Exchange the group descriptions within the node.
+   const int npub = pub_ldofs.Size(), ndescr = descr.Size();
+   node_npub.SetSize(node_size);
+   MPI_Allgather(&npub, 1, MPI_INT, node_npub.GetData(), 1, MPI_INT,
+                 node_comm);
+   Array<int> descr_cnt(node_size), descr_off(node_size + 1);
+   MPI_Allgather(&ndescr, 1, MPI_INT, descr_cnt.GetData(), 1, MPI_INT,
+                 node_comm);
+   descr_off[0] = 0;
+   for (int q = 0; q < node_size; q++)
+   {
+      descr_off[q + 1] = descr_off[q] + descr_cnt[q];
+   }
+   Array<int> all_descr(descr_off[node_size]);
+   MPI_Allgatherv(descr.GetData(), ndescr, MPI_INT, all_descr.GetData(),
+                  descr_cnt.GetData(), descr_off.GetData(), MPI_INT,
+                  node_comm);
+   typedef std::map<std::vector<int>, std::pair<int, int> > GroupMap;
+   std::vector<GroupMap> node_groups(node_size);
+   for (int q = 0; q < node_size; q++)
+   {
+      for (int k = descr_off[q]; k < descr_off[q + 1]; )
+      {
+         const int *d = all_descr.GetData() + k;
+         const int n = d[0];
+         std::vector<int> key(d + 1, d + 1 + n);
+         node_groups[q][key] = std::make_pair(d[1 + n], d[2 + n]);
+         k += n + 3;
+      }
+   }
+
+   // The owner of a group sums the values of the other ranks, which read the
+   // value of the owner.
+   for (int g = 1; g < ngroups; g++)
+   {
+      if (pub_offset[g] < 0) { continue; }
+      const int *ldofs = group_ldof.GetRow(g);
+      const int n = group_ldof.RowSize(g);
+      const bool master = gtopo.IAmMaster(g);
+      for (size_t j = 0; j < keys[g].size(); j++)
+      {
+         const int r = keys[g][j];
+         if (r == myid) { continue; }
+         if (!master && r != gtopo.GetGroupMasterRank(g)) { continue; }
+         const int q = node_index[r];
+         GroupMap::const_iterator it = node_groups[q].find(keys[g]);
+         MFEM_VERIFY(it != node_groups[q].end() && it->second.second == n,
+                     "Inconsistent shared group with rank " << r);
+         for (int i = 0; i < n; i++)
+         {
+            Array<int> &ldof = master ? red_ldof : bcast_ldof;
+            Array<int> &rank = master ? red_rank : bcast_rank;
+            Array<int> &idx = master ? red_idx : bcast_idx;
+            ldof.Append(ldofs[i]);
+            rank.Append(q);
+            idx.Append(it->second.first + i);
+         }
+      }
+   }
+
+   // Two buffers per rank, used in turn.
+   double *base;
+   MPI_Win_allocate_shared(2 * npub * (MPI_Aint) sizeof(double),
+                           sizeof(double), MPI_INFO_NULL, node_comm, &base,
+                           &win);
+   node_base.SetSize(node_size);
+   for (int q = 0; q < node_size; q++)
+   {
+      MPI_Aint size;
+      int disp_unit;
+      MPI_Win_shared_query(win, q, &size, &disp_unit, &node_base[q]);
+   }
+   MPI_Win_lock_all(MPI_MODE_NOCHECK, win);
+}
+
+NodeLocalProlongation::~NodeLocalProlongation()
+{
+   MPI_Win_unlock_all(win);
+   MPI_Win_free(&win);
+   MPI_Comm_free(&node_comm);
+}
+
+void NodeLocalProlongation::Publish(const double *ldata) const
+{
+   double *buf = Buffer(node_rank);
+   for (int k = 0; k < pub_ldofs.Size(); k++) { buf[k] = ldata[pub_ldofs[k]]; }
+}
+
+void NodeLocalProlongation::PublishWait() const
+{
+   MPI_Win_sync(win);
+   MPI_Barrier(node_comm);
+   MPI_Win_sync(win);
+}
+
+void NodeLocalProlongation::Mult(const Vector &x, Vector &y) const
+{
+   const double *xd = x.HostRead();
+   double *yd = y.HostWrite();
+   for (int i = 0; i < ltdof.Size(); i++)
+   {
+      if (ltdof[i] >= 0) { yd[i] = xd[ltdof[i]]; }
+   }
+   offnode.BcastBegin(yd, 0);
+   Publish(yd);
+   PublishWait();
+   for (int k = 0; k < bcast_ldof.Size(); k++)
+   {
+      yd[bcast_ldof[k]] = Buffer(bcast_rank[k])[bcast_idx[k]];
+   }
+   offnode.BcastEnd(yd, 0);
+   parity = 1 - parity;
+}
+
+void NodeLocalProlongation::MultTranspose(const Vector &x, Vector &y) const
+{
+   const double *xd = x.HostRead();
+   double *wd = work.HostWrite();
+   std::copy(xd, xd + work.Size(), wd);
+   ReduceBegin(wd);
+   ReduceEnd(wd);
+   double *yd = y.HostWrite();
+   for (int i = 0; i < ltdof.Size(); i++)
+   {
+      if (ltdof[i] >= 0) { yd[ltdof[i]] = wd[i]; }
+   }
+}
+
+void NodeLocalProlongation::ReduceBegin(const double *ldata) const
+{
+   offnode.ReduceBegin(ldata);
+   Publish(ldata);
+}
+
+void NodeLocalProlongation::ReduceEnd(double *ldata) const
+{
+   PublishWait();
+   for (int k = 0; k < red_ldof.Size(); k++)
+   {
+      ldata[red_ldof[k]] += Buffer(red_rank[k])[red_idx[k]];
+   }
+   offnode.ReduceEnd(ldata, 0, GroupCommunicator::Sum<double>);
+   parity = 1 - parity;
+}
+
+} // namespace hydrodynamics
+
+} // namespace mfem
+
+#endif // MFEM_USE_MPI
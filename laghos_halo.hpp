@@ -0,0 +1,94 @@
+// Copyright (c) 2017, Lawrence Livermore National Security, LLC. Produced at
+// the Lawrence Livermore National Laboratory. LLNL-CODE-734707. All Rights
+// reserved. See files LICENSE and NOTICE for details.
+//
+// This file is part of CEED, a collection of benchmarks, miniapps, software
+// libraries and APIs for efficient high-order finite element and spectral
+// element discretizations for exascale applications. For more information and
+// source code availability see http://github.com/ceed.
+//
+// The CEED research is supported by the Exascale Computing Project 17-SC-20-SC,
+// a collaborative effort of two U.S. Department of Energy organizations (Office
+// of Science and the National Nuclear Security Administration) responsible for
+// the planning and preparation of a capable exascale ecosystem, including
+// software, applications, hardware, advanced system engineering and early
+// testbed platforms, in support of the nation's exascale computing imperative.
+
+#ifndef MFEM_LAGHOS_HALO
+#define MFEM_LAGHOS_HALO
+
+#include "mfem.hpp"
+
+#ifdef MFEM_USE_MPI
+
+namespace mfem
+{
+
+namespace hydrodynamics
+{
+
+// Conforming prolongation P of an H1 space, as the one returned by
+// ParFiniteElementSpace::GetProlongationMatrix(), where the shared dofs of the
+// groups whose ranks are all on the same node are exchanged through an MPI-3
+// shared-memory window instead of messages. Each rank publishes the values of
+// its shared dofs in its part of the window, and the owners (P^T) or the other
+// ranks of the group (P) read them directly. The other groups use messages
+// through a GroupCommunicator. The window has two buffers, used in turn, so
+// one node barrier per application is enough. ReduceBegin() and ReduceEnd()
+// split the summation of P^T into the part that can overlap computation and
+// the waits. Host memory only.
+class NodeLocalProlongation : public Operator
+{
+private:
+   MPI_Comm node_comm;
+   int node_rank;
+   MPI_Win win;
+   // Groups with ranks on other nodes.
+   GroupCommunicator offnode;
+   // Local true dof of each ldof, -1 if not owned.
+   Array<int> ltdof;
+   // Ldofs published in the buffer of this rank, and the size of the buffers
+   // and their location for all ranks of the node.
+   Array<int> pub_ldofs;
+   Array<int> node_npub;
+   Array<double *> node_base;
+   // Values read in Mult(): ldof <- (node rank, buffer index), and summed in
+   // MultTranspose(): ldof += (node rank, buffer index).
+   Array<int> bcast_ldof, bcast_rank, bcast_idx;
+   Array<int> red_ldof, red_rank, red_idx;
+   mutable Vector work;
+   mutable int parity;
+
+   double *Buffer(const int q) const
+   { return node_base[q] + parity * node_npub[q]; }
+   // Publishes the shared values of ldata, and waits for the other ranks of
+   // the node to do the same.
+   void Publish(const double *ldata) const;
+   void PublishWait() const;
+
+public:
+   NodeLocalProlongation(ParFiniteElementSpace &pfes);
+   ~NodeLocalProlongation();
+
+   // Number of the shared dof values read from the window.
+   int NumNodeLocal() const { return bcast_ldof.Size() + red_ldof.Size(); }
+
+   virtual void Mult(const Vector &x, Vector &y) const;
+   virtual void MultTranspose(const Vector &x, Vector &y) const;
+
+   // Sums the shared entries of the L-vector ldata on the ranks that own them,
+   // in place, as GroupCommunicator::ReduceBegin/End() with the Sum operation.
+   // The other ranks of the node read the values published by ReduceBegin()
+   // after the node barrier of ReduceEnd(), so ldata may be overwritten with
+   // the same values in between.
+   void ReduceBegin(const double *ldata) const;
+   void ReduceEnd(double *ldata) const;
+};
+
+} // namespace hydrodynamics
+
+} // namespace mfem
+
+#endif // MFEM_USE_MPI
+
+#endif // MFEM_LAGHOS_HALO
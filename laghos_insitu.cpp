@@ -0,0 +1,170 @@
+// Copyright (c) 2017, Lawrence Livermore National Security, LLC. Produced at
+// the Lawrence Livermore National Laboratory. LLNL-CODE-734707. All Rights
+// reserved. See files LICENSE and NOTICE for details.
+//
+// This file is part of CEED, a collection of benchmarks, miniapps, software
+// libraries and APIs for efficient high-order finite element and spectral
+// element discretizations for exascale applications. For more information and
+// source code availability see http://github.com/ceed.
+//
+// The CEED research is supported by the Exascale Computing Project 17-SC-20-SC,
+// a collaborative effort of two U.S. Department of Energy organizations (Office
+// of Science and the National Nuclear Security Administration) responsible for
+// the planning and preparation of a capable exascale ecosystem, including
+// software, applications, hardware, advanced system engineering and early
+// testbed platforms, in support of the nation's exascale computing imperative.
+
+#include "laghos_insitu.hpp"
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <limits>
+#include <string>
+
+#ifdef MFEM_USE_MPI
+
+namespace mfem
+{
+
+namespace hydrodynamics
+{
+
+InSituAnalysis::InSituAnalysis(const LagrangianHydroOperator &hydro,
+                               const ParMesh &pmesh, const char *basename,
+                               const int nbins, const double *shock_center,
+                               const double interface_rho0, const bool append)
+   : hydro(hydro), comm(pmesh.GetComm()), dim(pmesh.Dimension()),
+     nbins(nbins), root(pmesh.GetMyRank() == 0),
+     shock(shock_center != NULL), interface(interface_rho0 > 0.0),
+     interface_rho0(interface_rho0)
+{
+   MFEM_VERIFY(nbins > 0, "Invalid number of histogram bins " << nbins);
+   for (int d = 0; d < 3; d++) { center[d] = shock ? shock_center[d] : 0.0; }
+   if (!root) { return; }
+
+   const std::ios_base::openmode mode =
+      append ? std::ios_base::app : std::ios_base::trunc;
+   const std::string name(basename);
+   series.open((name + "_insitu.dat").c_str(), std::ios_base::out | mode);
+   histograms.open((name + "_insitu_hist.dat").c_str(),
+                   std::ios_base::out | mode);
+   MFEM_VERIFY(series && histograms, "Cannot open the in-situ output files.");
+   series << std::scientific << std::setprecision(10);
+   histograms << std::scientific << std::setprecision(6);
+   if (append) { return; }
+   series << "# cycle time rho_min rho_max e_min e_max |v|_max"
+          << " internal_energy kinetic_energy total_energy";
+   if (shock) { series << " shock_radius"; }
+   if (interface) { series << " heavy_min light_max"; }
+   series << std::endl;
+   histograms << "# cycle time field min max, followed by the mass in each of "
+              << nbins << " bins" << std::endl;
+}
+
+static int Bin(const double val, const double lo, const double hi,
+               const int nbins)
+{
+   if (!(hi > lo)) { return 0; }
+   const int b = static_cast<int>((val - lo) / (hi - lo) * nbins);
+   return std::min(std::max(b, 0), nbins - 1);
+}
+
+void InSituAnalysis::Compute(const Vector &S, const int cycle,
+                             const double time)
+{
+   hydro.ComputeQuadratureFields(S, qf);
+   const int NP = qf.rho.Size();
+   const double *X = qf.x.HostRead();
+   const double *V = qf.v.HostRead();
+   const double *R = qf.rho.HostRead();
+   const double *E = qf.e.HostRead();
+   const double *M = qf.mass.HostRead();
+   const double *R0 = qf.rho0.HostRead();
+
+   // Maxima: rho, -rho, e, -e, |v|, minus the lowest vertical coordinate of
+   // the heavy material and the highest one of the light material.
+   const double inf = std::numeric_limits<double>::infinity();
+   double mx[7] = { -inf, -inf, -inf, -inf, 0.0, -inf, -inf };
+   double r_rho_max = 0.0;
+   for (int i = 0; i < NP; i++)
+   {
+      double v2 = 0.0, r2 = 0.0;
+      for (int d = 0; d < dim; d++)
+      {
+         const double dx = X[dim*i + d] - center[d];
+         v2 += V[dim*i + d] * V[dim*i + d];
+         r2 += dx * dx;
+      }
+      if (R[i] > mx[0]) { mx[0] = R[i]; r_rho_max = sqrt(r2); }
+      mx[1] = std::max(mx[1], -R[i]);
+      mx[2] = std::max(mx[2], E[i]);
+      mx[3] = std::max(mx[3], -E[i]);
+      mx[4] = std::max(mx[4], sqrt(v2));
+      if (interface)
+      {
+         const double y = X[dim*i + dim - 1];
+         if (R0[i] > interface_rho0) { mx[5] = std::max(mx[5], -y); }
+         else { mx[6] = std::max(mx[6], y); }
+      }
+   }
+   const double rho_max_loc = mx[0];
+   MPI_Allreduce(MPI_IN_PLACE, mx, 7, MPI_DOUBLE, MPI_MAX, comm);
+
+   // Sums: internal and kinetic energy, the shock radius and the count of the
+   // ranks that hold the global density maximum, and the histograms.
+   const int nsums = 4 + 3*nbins;
+   hist.SetSize(nsums);
+   double *H = hist.HostWrite();
+   std::fill(H, H + nsums, 0.0);
+   if (shock && NP > 0 && rho_max_loc == mx[0])
+   {
+      H[2] = r_rho_max;
+      H[3] = 1.0;
+   }
+   const double lo[3] = { -mx[1], -mx[3], 0.0 };
+   const double hi[3] = { mx[0], mx[2], mx[4] };
+   for (int i = 0; i < NP; i++)
+   {
+      double v2 = 0.0;
+      for (int d = 0; d < dim; d++) { v2 += V[dim*i + d] * V[dim*i + d]; }
+      H[0] += M[i] * E[i];
+      H[1] += 0.5 * M[i] * v2;
+      const double vals[3] = { R[i], E[i], sqrt(v2) };
+      for (int f = 0; f < 3; f++)
+      {
+         H[4 + f*nbins + Bin(vals[f], lo[f], hi[f], nbins)] += M[i];
+      }
+   }
+   if (root)
+   {
+      MPI_Reduce(MPI_IN_PLACE, H, nsums, MPI_DOUBLE, MPI_SUM, 0, comm);
+   }
+   else { MPI_Reduce(H, NULL, nsums, MPI_DOUBLE, MPI_SUM, 0, comm); }
+   if (!root) { return; }
+
+   series << cycle << " " << time << " " << lo[0] << " " << hi[0] << " "
+          << lo[1] << " " << hi[1] << " " << hi[2] << " " << H[0] << " "
+          << H[1] << " " << H[0] + H[1];
+   if (shock) { series << " " << H[2] / std::max(H[3], 1.0); }
+   if (interface) { series << " " << -mx[5] << " " << mx[6]; }
+   series << std::endl;
+
+   const char *names[3] = { "rho", "e", "|v|" };
+   for (int f = 0; f < 3; f++)
+   {
+      histograms << cycle << " " << time << " " << names[f] << " "
+                 << lo[f] << " " << hi[f];
+      for (int b = 0; b < nbins; b++)
+      {
+         histograms << " " << H[4 + f*nbins + b];
+      }
+      histograms << "\n";
+   }
+   histograms.flush();
+}
+
+} // namespace hydrodynamics
+
+} // namespace mfem
+
+#endif // MFEM_USE_MPI
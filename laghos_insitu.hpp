@@ -0,0 +1,78 @@
+// Copyright (c) 2017, Lawrence Livermore National Security, LLC. Produced at
+// the Lawrence Livermore National Laboratory. LLNL-CODE-734707. All Rights
+// reserved. See files LICENSE and NOTICE for details.
+//
+// This file is part of CEED, a collection of benchmarks, miniapps, software
+// libraries and APIs for efficient high-order finite element and spectral
+// element discretizations for exascale applications. For more information and
+// source code availability see http://github.com/ceed.
+//
+// The CEED research is supported by the Exascale Computing Project 17-SC-20-SC,
+// a collaborative effort of two U.S. Department of Energy organizations (Office
+// of Science and the National Nuclear Security Administration) responsible for
+// the planning and preparation of a capable exascale ecosystem, including
+// software, applications, hardware, advanced system engineering and early
+// testbed platforms, in support of the nation's exascale computing imperative.
+
+#ifndef MFEM_LAGHOS_INSITU
+#define MFEM_LAGHOS_INSITU
+
+#include "mfem.hpp"
+#include "laghos_solver.hpp"
+#include <fstream>
+
+#ifdef MFEM_USE_MPI
+
+namespace mfem
+{
+
+namespace hydrodynamics
+{
+
+// In-situ analysis of the quadrature point values of the state. Every call of
+// Compute() reduces them to a few global quantities, which rank 0 appends as
+// one line to the time series file <basename>_insitu.dat:
+//  - the minimum and maximum of the density and of the specific internal
+//    energy, and the maximum of |v|,
+//  - the energy budget: internal, kinetic and total energy,
+//  - optionally, the shock radius, i.e., the distance of the point of maximum
+//    density from a given center (Sedov),
+//  - optionally, the interface position, i.e., the lowest and highest vertical
+//    coordinates of the heavy and of the light material, separated by a given
+//    initial density (Rayleigh-Taylor).
+// The mass-weighted histograms of rho, e and |v| between their global minimum
+// and maximum are appended to <basename>_insitu_hist.dat. Each call uses two
+// global reductions.
+class InSituAnalysis
+{
+private:
+   const LagrangianHydroOperator &hydro;
+   const MPI_Comm comm;
+   const int dim, nbins;
+   const bool root, shock, interface;
+   double center[3];
+   const double interface_rho0;
+   QuadratureFields qf;
+   Vector hist;
+   std::ofstream series, histograms;
+
+public:
+   // The shock radius is computed when shock_center is given, and the
+   // interface position when interface_rho0 is positive. With append, the
+   // files are continued, e.g., after a restart.
+   InSituAnalysis(const LagrangianHydroOperator &hydro, const ParMesh &pmesh,
+                  const char *basename, const int nbins,
+                  const double *shock_center, const double interface_rho0,
+                  const bool append);
+
+   // Collective on the communicator of the mesh.
+   void Compute(const Vector &S, const int cycle, const double time);
+};
+
+} // namespace hydrodynamics
+
+} // namespace mfem
+
+#endif // MFEM_USE_MPI
+
+#endif // MFEM_LAGHOS_INSITU
@@ -0,0 +1,938 @@
+// Copyright (c) 2017, Lawrence Livermore National Security, LLC. Produced at
+// the Lawrence Livermore National Laboratory. LLNL-CODE-734707. All Rights
+// reserved. See files LICENSE and NOTICE for details.
+//
+// This file is part of CEED, a collection of benchmarks, miniapps, software
+// libraries and APIs for efficient high-order finite element and spectral
+// element discretizations for exascale applications. For more information and
+// source code availability see http://github.com/ceed.
+//
+// The CEED research is supported by the Exascale Computing Project 17-SC-20-SC,
+// a collaborative effort of two U.S. Department of Energy organizations (Office
+// of Science and the National Nuclear Security Administration) responsible for
+// the planning and preparation of a capable exascale ecosystem, including
+// software, applications, hardware, advanced system engineering and early
+// testbed platforms, in support of the nation's exascale computing imperative.
+
+#include "laghos_io.hpp"
+#include "laghos_mesh.hpp"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+
+#ifdef MFEM_USE_MPI
+
+namespace mfem
+{
+
+namespace hydrodynamics
+{
+
+// Checkpoint file layout (native byte order):
+//   char[8]   magic "LAGHOSCK"
+//   int[3]    version, number of ranks, rank
+//   int[3]    ti, steps, checks
+//   double[4] t, dt, h0, energy_drift
+//   double[4] timer real times
+//   double[6] phase timer real times
+//   int64[3]  timer counters
+//   int64     size of S,  followed by the S values
+//   int64     size of x0, followed by the x0 values
+//   int64     size of the integer mesh array, followed by its values (int)
+//   int64     size of the real mesh array, followed by its values
+// The mesh arrays are the ones of GetParMeshArrays(), without the nodes.
+static const char ckpt_magic[8] = { 'L','A','G','H','O','S','C','K' };
+static const int ckpt_version = 3;
+
+template <typename T>
+static void WriteRaw(std::ostream &os, const T *data, const long long n)
+{
+   os.write(reinterpret_cast<const char *>(data), n * sizeof(T));
+}
+
+template <typename T>
+static void ReadRaw(std::istream &is, T *data, const long long n)
+{
+   is.read(reinterpret_cast<char *>(data), n * sizeof(T));
+}
+
+static void WriteVector(std::ostream &os, const Vector &v)
+{
+   const long long n = v.Size();
+   WriteRaw(os, &n, 1);
+   WriteRaw(os, v.HostRead(), n);
+}
+
+static void ReadVector(std::istream &is, Vector &v)
+{
+   long long n;
+   ReadRaw(is, &n, 1);
+   v.SetSize(n);
+   ReadRaw(is, v.HostWrite(), n);
+}
+
+std::string CheckpointPrefix(const char *basename, const int ti)
+{
+   std::ostringstream prefix;
+   prefix << basename << "_ckpt_" << std::setfill('0') << std::setw(6) << ti;
+   return prefix.str();
+}
+
+std::string RankFileName(const std::string &prefix, const int rank)
+{
+   std::ostringstream fname;
+   fname << prefix << '.' << std::setfill('0') << std::setw(6) << rank;
+   return fname.str();
+}
+
+void SaveCheckpoint(const std::string &prefix, ParMesh &pmesh,
+                    Checkpoint &ckpt)
+{
+   GetParMeshArrays(pmesh, ckpt.mesh_ints, ckpt.mesh_reals, false);
+
+   const std::string fname = RankFileName(prefix, pmesh.GetMyRank());
+   const std::string tmp_name = fname + ".tmp";
+   std::ofstream os(tmp_name.c_str(), std::ios::binary);
+   MFEM_VERIFY(os, "Cannot open checkpoint file " << tmp_name);
+
+   const int header[3] = { ckpt_version, pmesh.GetNRanks(), pmesh.GetMyRank() };
+   const int counters[3] = { ckpt.ti, ckpt.steps, ckpt.checks };
+   const double scalars[4] = { ckpt.t, ckpt.dt, ckpt.h0, ckpt.energy_drift };
+   WriteRaw(os, ckpt_magic, 8);
+   WriteRaw(os, header, 3);
+   WriteRaw(os, counters, 3);
+   WriteRaw(os, scalars, 4);
+   WriteRaw(os, ckpt.timer_rt, 4);
+   WriteRaw(os, ckpt.phase_rt, 6);
+   WriteRaw(os, ckpt.timer_cnt, 3);
+   WriteVector(os, ckpt.S);
+   WriteVector(os, ckpt.x0);
+   const long long nints = ckpt.mesh_ints.Size();
+   WriteRaw(os, &nints, 1);
+   WriteRaw(os, ckpt.mesh_ints.GetData(), nints);
+   WriteVector(os, ckpt.mesh_reals);
+   os.close();
+   MFEM_VERIFY(os, "Error writing checkpoint file " << tmp_name);
+   MFEM_VERIFY(std::rename(tmp_name.c_str(), fname.c_str()) == 0,
+               "Cannot rename " << tmp_name << " to " << fname);
+}
+
+ParMesh *LoadCheckpoint(const std::string &prefix, MPI_Comm comm,
+                        Checkpoint &ckpt)
+{
+   int nranks, myid;
+   MPI_Comm_size(comm, &nranks);
+   MPI_Comm_rank(comm, &myid);
+   const std::string fname = RankFileName(prefix, myid);
+   std::ifstream is(fname.c_str(), std::ios::binary);
+   MFEM_VERIFY(is, "Cannot open checkpoint file " << fname);
+
+   char magic[8];
+   int header[3], counters[3];
+   double scalars[4];
+   ReadRaw(is, magic, 8);
+   MFEM_VERIFY(is && std::equal(magic, magic + 8, ckpt_magic),
+               fname << " is not a Laghos checkpoint.");
+   ReadRaw(is, header, 3);
+   MFEM_VERIFY(header[0] == ckpt_version,
+               "Unsupported checkpoint version " << header[0]);
+   MFEM_VERIFY(header[1] == nranks && header[2] == myid,
+               "The checkpoint was written by " << header[1] << " ranks; "
+               "restart with the same number of ranks.");
+   ReadRaw(is, counters, 3);
+   ReadRaw(is, scalars, 4);
+   ReadRaw(is, ckpt.timer_rt, 4);
+   ReadRaw(is, ckpt.phase_rt, 6);
+   ReadRaw(is, ckpt.timer_cnt, 3);
+   ckpt.ti = counters[0];
+   ckpt.steps = counters[1];
+   ckpt.checks = counters[2];
+   ckpt.t = scalars[0];
+   ckpt.dt = scalars[1];
+   ckpt.h0 = scalars[2];
+   ckpt.energy_drift = scalars[3];
+   ReadVector(is, ckpt.S);
+   ReadVector(is, ckpt.x0);
+   long long nints;
+   ReadRaw(is, &nints, 1);
+   MFEM_VERIFY(is && nints >= 0 && nints <= INT_MAX,
+               "Error reading checkpoint file " << fname);
+   ckpt.mesh_ints.SetSize(nints);
+   ReadRaw(is, ckpt.mesh_ints.GetData(), nints);
+   ReadVector(is, ckpt.mesh_reals);
+   MFEM_VERIFY(is, "Error reading checkpoint file " << fname);
+
+   return MakeParMesh(comm, ckpt.mesh_ints, ckpt.mesh_reals);
+}
+
+// Snapshot file layout (native byte order):
+//   char[8]   magic "LAGHOSMP"
+//   int[4]    version, number of ranks, number of fields, cycle
+//   double    time
+//   char[32]  name of each field
+//   int64[3+nfields] index entry of each rank: offset of its slice in the
+//             file, sizes of its integer and real mesh arrays and the number
+//             of values of each of its fields
+//   slices    integer mesh array (int), real mesh array (double), followed by
+//             the field values (double)
+// The mesh arrays are the ones of GetParMeshArrays().
+static const char snap_magic[8] = { 'L','A','G','H','O','S','M','P' };
+static const int snap_version = 2;
+static const int snap_name_len = 32;
+
+static void WriteAtAll(MPI_File fh, const MPI_Offset pos, const void *data,
+                       const long long count, MPI_Datatype type)
+{
+   MFEM_VERIFY(count <= INT_MAX, "The slice of a rank is too large.");
+   MPI_File_write_at_all(fh, pos, const_cast<void *>(data), (int) count, type,
+                         MPI_STATUS_IGNORE);
+}
+
+void SaveSnapshotMPIIO(const std::string &fname, const ParMesh &pmesh,
+                       const double time, const int cycle, const int nfields,
+                       const char *const names[],
+                       const ParGridFunction *const fields[])
+{
+   const MPI_Comm comm = pmesh.GetComm();
+   const int nranks = pmesh.GetNRanks(), myid = pmesh.GetMyRank();
+
+   Array<int> mesh_ints;
+   Vector mesh_reals;
+   GetParMeshArrays(const_cast<ParMesh &>(pmesh), mesh_ints, mesh_reals);
+
+   // Index entry of this rank. The slices are stored in rank order, so the
+   // offsets follow from an exclusive scan of the slice sizes.
+   Array<long long> entry(3 + nfields);
+   entry[1] = mesh_ints.Size();
+   entry[2] = mesh_reals.Size();
+   long long slice_bytes = entry[1] * (long long) sizeof(int) +
+                           entry[2] * (long long) sizeof(double);
+   for (int f = 0; f < nfields; f++)
+   {
+      entry[3 + f] = fields[f]->Size();
+      slice_bytes += entry[3 + f] * (long long) sizeof(double);
+   }
+   long long offset = 0;
+   MPI_Exscan(&slice_bytes, &offset, 1, MPI_LONG_LONG, MPI_SUM, comm);
+   if (myid == 0) { offset = 0; }
+
+   std::ostringstream header;
+   const int header_ints[4] = { snap_version, nranks, nfields, cycle };
+   WriteRaw(header, snap_magic, 8);
+   WriteRaw(header, header_ints, 4);
+   WriteRaw(header, &time, 1);
+   for (int f = 0; f < nfields; f++)
+   {
+      char name[snap_name_len] = { 0 };
+      std::strncpy(name, names[f], snap_name_len - 1);
+      WriteRaw(header, name, snap_name_len);
+   }
+   const std::string header_str = header.str();
+   const long long header_bytes = header_str.size();
+   const long long entry_bytes = entry.Size() * (long long) sizeof(long long);
+   entry[0] = header_bytes + nranks * entry_bytes + offset;
+
+   MPI_File fh;
+   const int err = MPI_File_open(comm, const_cast<char *>(fname.c_str()),
+                                 MPI_MODE_CREATE | MPI_MODE_WRONLY,
+                                 MPI_INFO_NULL, &fh);
+   MFEM_VERIFY(err == MPI_SUCCESS, "Cannot open " << fname);
+   MPI_File_set_size(fh, 0);
+   if (myid == 0)
+   {
+      MPI_File_write_at(fh, 0, const_cast<char *>(header_str.data()),
+                        (int) header_bytes, MPI_BYTE, MPI_STATUS_IGNORE);
+   }
+   WriteAtAll(fh, header_bytes + myid * entry_bytes, entry.GetData(),
+              entry.Size(), MPI_LONG_LONG);
+   MPI_Offset pos = entry[0];
+   WriteAtAll(fh, pos, mesh_ints.GetData(), entry[1], MPI_INT);
+   pos += entry[1] * (long long) sizeof(int);
+   WriteAtAll(fh, pos, mesh_reals.GetData(), entry[2], MPI_DOUBLE);
+   pos += entry[2] * (long long) sizeof(double);
+   for (int f = 0; f < nfields; f++)
+   {
+      WriteAtAll(fh, pos, fields[f]->HostRead(), entry[3 + f], MPI_DOUBLE);
+      pos += entry[3 + f] * (long long) sizeof(double);
+   }
+   MPI_File_close(&fh);
+}
+
+static void ReadAtAll(MPI_File fh, const MPI_Offset pos, void *data,
+                      const long long count, MPI_Datatype type)
+{
+   MFEM_VERIFY(count <= INT_MAX, "The slice of a rank is too large.");
+   MPI_File_read_at_all(fh, pos, data, (int) count, type, MPI_STATUS_IGNORE);
+}
+
+// Opens the snapshot and reads its header, the field names and the index
+// entry of this rank.
+static MPI_File OpenSnapshot(const std::string &fname, MPI_Comm comm,
+                             std::vector<std::string> &names,
+                             Array<long long> &entry)
+{
+   int nranks, myid;
+   MPI_Comm_size(comm, &nranks);
+   MPI_Comm_rank(comm, &myid);
+   MPI_File fh;
+   const int err = MPI_File_open(comm, const_cast<char *>(fname.c_str()),
+                                 MPI_MODE_RDONLY, MPI_INFO_NULL, &fh);
+   MFEM_VERIFY(err == MPI_SUCCESS, "Cannot open " << fname);
+
+   char magic[8];
+   int header_ints[4];
+   ReadAtAll(fh, 0, magic, 8, MPI_CHAR);
+   ReadAtAll(fh, 8, header_ints, 4, MPI_INT);
+   MFEM_VERIFY(std::equal(magic, magic + 8, snap_magic),
+               fname << " is not a Laghos MPI-IO snapshot.");
+   MFEM_VERIFY(header_ints[0] == snap_version,
+               "Unsupported snapshot version " << header_ints[0]);
+   MFEM_VERIFY(header_ints[1] == nranks,
+               fname << " was written by " << header_ints[1] << " ranks; "
+               "use the same number of ranks.");
+   const int nfields = header_ints[2];
+   const long long header_bytes = 8 + 4 * sizeof(int) + sizeof(double) +
+                                  nfields * snap_name_len;
+   const long long entry_bytes = (3 + nfields) * (long long) sizeof(long long);
+
+   std::vector<char> name_chars(nfields * snap_name_len + 1, '\0');
+   ReadAtAll(fh, header_bytes - nfields * snap_name_len, name_chars.data(),
+             nfields * snap_name_len, MPI_CHAR);
+   names.resize(nfields);
+   for (int f = 0; f < nfields; f++)
+   {
+      names[f] = name_chars.data() + f * snap_name_len;
+   }
+   entry.SetSize(3 + nfields);
+   ReadAtAll(fh, header_bytes + myid * entry_bytes, entry.GetData(),
+             entry.Size(), MPI_LONG_LONG);
+   return fh;
+}
+
+ParMesh *LoadSnapshotMeshMPIIO(const std::string &fname, MPI_Comm comm)
+{
+   std::vector<std::string> names;
+   Array<long long> entry;
+   MPI_File fh = OpenSnapshot(fname, comm, names, entry);
+   Array<int> mesh_ints(entry[1]);
+   Vector mesh_reals(entry[2]);
+   ReadAtAll(fh, entry[0], mesh_ints.GetData(), entry[1], MPI_INT);
+   ReadAtAll(fh, entry[0] + entry[1] * (long long) sizeof(int),
+             mesh_reals.GetData(), entry[2], MPI_DOUBLE);
+   MPI_File_close(&fh);
+
+   return MakeParMesh(comm, mesh_ints, mesh_reals);
+}
+
+void LoadSnapshotFieldMPIIO(const std::string &fname, MPI_Comm comm,
+                            const std::string &name, Vector &values)
+{
+   std::vector<std::string> names;
+   Array<long long> entry;
+   MPI_File fh = OpenSnapshot(fname, comm, names, entry);
+   const int f = static_cast<int>(std::find(names.begin(), names.end(), name) -
+                                  names.begin());
+   const int nfields = static_cast<int>(names.size());
+   MFEM_VERIFY(f < nfields, "No field " << name << " in " << fname);
+   MPI_Offset pos = entry[0] + entry[1] * (long long) sizeof(int) +
+                    entry[2] * (long long) sizeof(double);
+   for (int g = 0; g < f; g++)
+   {
+      pos += entry[3 + g] * (long long) sizeof(double);
+   }
+   values.SetSize(entry[3 + f]);
+   ReadAtAll(fh, pos, values.HostWrite(), entry[3 + f], MPI_DOUBLE);
+   MPI_File_close(&fh);
+}
+
+// Compressed field file layout (native byte order):
+//   char[8]   magic "LAGHOSQZ"
+//   int[4]    version, number of ranks, rank, number of fields
+//   int       cycle
+//   double    time
+//   fields    for each field: its name and the name of its finite element
+//             collection (int64 length, followed by the characters), int[3]
+//             vdim, ordering and block size, double tolerance, int64 number
+//             of values, int64 size of the coded data, and the coded data.
+// The coded data is a bit stream with, for each block, a 1-bit flag for
+// uncompressed blocks, followed by the 64-bit values, or a 6-bit Golomb-Rice
+// parameter k, followed by the codes of the zigzag-mapped differences of the
+// consecutive quantized values: the quotient in unary (escaped with 32 ones,
+// followed by the 64-bit value), and the k low bits.
+static const char cmp_magic[8] = { 'L','A','G','H','O','S','Q','Z' };
+static const int cmp_version = 1;
+static const int cmp_max_unary = 32;
+
+class BitWriter
+{
+private:
+   std::string &buf;
+   unsigned long long acc;
+   int nbits;
+
+public:
+   BitWriter(std::string &buf) : buf(buf), acc(0), nbits(0) { }
+
+   // Appends the n low bits of v, most significant first.
+   void Put(unsigned long long v, int n)
+   {
+      if (n > 32)
+      {
+         Put(v >> 32, n - 32);
+         n = 32;
+      }
+      const unsigned long long mask = (1ull << n) - 1;
+      acc = (acc << n) | (v & mask);
+      nbits += n;
+      while (nbits >= 8)
+      {
+         nbits -= 8;
+         buf.push_back(static_cast<char>((acc >> nbits) & 0xff));
+      }
+   }
+
+   void Flush() { if (nbits > 0) { Put(0, 8 - nbits); } }
+};
+
+class BitReader
+{
+private:
+   const std::string &buf;
+   size_t pos;
+   unsigned long long acc;
+   int nbits;
+
+public:
+   BitReader(const std::string &buf) : buf(buf), pos(0), acc(0), nbits(0) { }
+
+   unsigned long long Get(int n)
+   {
+      if (n > 32)
+      {
+         const unsigned long long hi = Get(n - 32);
+         return (hi << 32) | Get(32);
+      }
+      while (nbits < n)
+      {
+         MFEM_VERIFY(pos < buf.size(), "Truncated compressed data.");
+         acc = (acc << 8) | static_cast<unsigned char>(buf[pos++]);
+         nbits += 8;
+      }
+      nbits -= n;
+      return (acc >> nbits) & ((1ull << n) - 1);
+   }
+};
+
+static unsigned long long ZigZag(const long long r)
+{
+   return (static_cast<unsigned long long>(r) << 1) ^
+          static_cast<unsigned long long>(r >> 63);
+}
+
+static long long UnZigZag(const unsigned long long u)
+{
+   return static_cast<long long>(u >> 1) ^ -static_cast<long long>(u & 1);
+}
+
+static void EncodeBlock(BitWriter &bw, const double *x, const int n,
+                        const double tol, Array<long long> &q)
+{
+   // Quantize; values beyond the exactly representable integers of a double
+   // and non-finite values are stored uncompressed.
+   const double scale = 1.0 / (2.0 * tol);
+   const double q_max = 4503599627370496.0; // 2^52
+   bool raw = false;
+   double mean = 0.0;
+   for (int i = 0; i < n; i++)
+   {
+      const double qx = x[i] * scale;
+      if (!(std::abs(qx) < q_max)) { raw = true; break; }
+      q[i] = std::llround(qx);
+      const long long r = q[i] - (i > 0 ? q[i-1] : 0);
+      mean += ZigZag(r);
+   }
+   bw.Put(raw, 1);
+   if (raw)
+   {
+      for (int i = 0; i < n; i++)
+      {
+         unsigned long long bits;
+         std::memcpy(&bits, &x[i], sizeof(bits));
+         bw.Put(bits, 64);
+      }
+      return;
+   }
+
+   // The Golomb-Rice parameter that is optimal for geometrically distributed
+   // values with the mean of the block.
+   mean /= n;
+   int k = 0;
+   while (k < 62 && std::ldexp(1.0, k + 1) <= mean) { k++; }
+   bw.Put(k, 6);
+   for (int i = 0; i < n; i++)
+   {
+      const unsigned long long u = ZigZag(q[i] - (i > 0 ? q[i-1] : 0));
+      const unsigned long long quot = u >> k;
+      if (quot < cmp_max_unary)
+      {
+         bw.Put(((1ull << quot) - 1) << 1, quot + 1);
+         bw.Put(u, k);
+      }
+      else
+      {
+         bw.Put((1ull << cmp_max_unary) - 1, cmp_max_unary);
+         bw.Put(u, 64);
+      }
+   }
+}
+
+static void DecodeBlock(BitReader &br, double *x, const int n,
+                        const double tol)
+{
+   if (br.Get(1))
+   {
+      for (int i = 0; i < n; i++)
+      {
+         const unsigned long long bits = br.Get(64);
+         std::memcpy(&x[i], &bits, sizeof(bits));
+      }
+      return;
+   }
+   const int k = br.Get(6);
+   long long q = 0;
+   for (int i = 0; i < n; i++)
+   {
+      int quot = 0;
+      while (quot < cmp_max_unary && br.Get(1)) { quot++; }
+      const unsigned long long u = (quot < cmp_max_unary) ?
+                                   ((static_cast<unsigned long long>(quot) << k)
+                                    | br.Get(k)) : br.Get(64);
+      q += UnZigZag(u);
+      x[i] = 2.0 * tol * q;
+   }
+}
+
+static void WriteString(std::ostream &os, const std::string &str)
+{
+   const long long n = str.size();
+   WriteRaw(os, &n, 1);
+   WriteRaw(os, str.data(), n);
+}
+
+static std::string ReadString(std::istream &is)
+{
+   long long n = 0;
+   ReadRaw(is, &n, 1);
+   MFEM_VERIFY(is && n >= 0, "Error reading a compressed field file.");
+   std::string str(n, '\0');
+   if (n > 0) { ReadRaw(is, &str[0], n); }
+   return str;
+}
+
+long long SaveCompressed(const std::string &prefix, const ParMesh &pmesh,
+                         const double time, const int cycle,
+                         const double abs_tol, const double rel_tol,
+                         const int nfields, const char *const names[],
+                         const ParGridFunction *const fields[])
+{
+   MFEM_VERIFY(abs_tol > 0.0 || rel_tol > 0.0,
+               "A positive absolute or relative tolerance is required.");
+   const std::string fname = RankFileName(prefix, pmesh.GetMyRank());
+   std::ofstream os(fname.c_str(), std::ios::binary);
+   MFEM_VERIFY(os, "Cannot open compressed field file " << fname);
+   const int header[4] = { cmp_version, pmesh.GetNRanks(), pmesh.GetMyRank(),
+                           nfields
+                         };
+   WriteRaw(os, cmp_magic, 8);
+   WriteRaw(os, header, 4);
+   WriteRaw(os, &cycle, 1);
+   WriteRaw(os, &time, 1);
+
+   // The tolerances of all fields, with a single reduction.
+   Vector max_abs(nfields);
+   for (int f = 0; f < nfields; f++) { max_abs(f) = fields[f]->Normlinf(); }
+   MPI_Allreduce(MPI_IN_PLACE, max_abs.GetData(), nfields, MPI_DOUBLE,
+                 MPI_MAX, pmesh.GetComm());
+
+   std::string data;
+   Array<long long> q;
+   for (int f = 0; f < nfields; f++)
+   {
+      const ParGridFunction &gf = *fields[f];
+      const ParFiniteElementSpace &fes = *gf.ParFESpace();
+      double tol = abs_tol;
+      if (rel_tol > 0.0)
+      {
+         const double tol_rel = rel_tol * max_abs(f);
+         // Zero fields are represented exactly with any tolerance.
+         tol = (max_abs(f) == 0.0) ? 1.0 :
+               (abs_tol > 0.0) ? std::min(abs_tol, tol_rel) : tol_rel;
+      }
+      // Blocks of whole elements, of at least 256 values.
+      const int el_dofs = (fes.GetNE() > 0) ? fes.GetFE(0)->GetDof() : 1;
+      const int block_size = el_dofs * std::max(1, 256 / el_dofs);
+      const int params[3] = { fes.GetVDim(), fes.GetOrdering(), block_size };
+      const long long size = gf.Size();
+
+      data.clear();
+      q.SetSize(block_size);
+      BitWriter bw(data);
+      const double *x = gf.HostRead();
+      for (long long i = 0; i < size; i += block_size)
+      {
+         const int n = std::min<long long>(block_size, size - i);
+         EncodeBlock(bw, x + i, n, tol, q);
+      }
+      bw.Flush();
+
+      WriteString(os, names[f]);
+      WriteString(os, fes.FEColl()->Name());
+      WriteRaw(os, params, 3);
+      WriteRaw(os, &tol, 1);
+      WriteRaw(os, &size, 1);
+      WriteString(os, data);
+   }
+   const long long nbytes = os.tellp();
+   os.close();
+   MFEM_VERIFY(os, "Error writing compressed field file " << fname);
+   return nbytes;
+}
+
+ParGridFunction *LoadCompressed(const std::string &prefix, ParMesh &pmesh,
+                                const std::string &name, double *time,
+                                int *cycle)
+{
+   const std::string fname = RankFileName(prefix, pmesh.GetMyRank());
+   std::ifstream is(fname.c_str(), std::ios::binary);
+   MFEM_VERIFY(is, "Cannot open compressed field file " << fname);
+   char magic[8];
+   int header[4], file_cycle;
+   double file_time;
+   ReadRaw(is, magic, 8);
+   MFEM_VERIFY(is && std::equal(magic, magic + 8, cmp_magic),
+               fname << " is not a Laghos compressed field file.");
+   ReadRaw(is, header, 4);
+   MFEM_VERIFY(header[0] == cmp_version,
+               "Unsupported compressed field version " << header[0]);
+   MFEM_VERIFY(header[1] == pmesh.GetNRanks() &&
+               header[2] == pmesh.GetMyRank(),
+               "The file was written by " << header[1] << " ranks.");
+   ReadRaw(is, &file_cycle, 1);
+   ReadRaw(is, &file_time, 1);
+   if (time) { *time = file_time; }
+   if (cycle) { *cycle = file_cycle; }
+
+   for (int f = 0; f < header[3]; f++)
+   {
+      const std::string field_name = ReadString(is);
+      const std::string fec_name = ReadString(is);
+      int params[3];
+      double tol;
+      long long size;
+      ReadRaw(is, params, 3);
+      ReadRaw(is, &tol, 1);
+      ReadRaw(is, &size, 1);
+      const std::string data = ReadString(is);
+      if (field_name != name) { continue; }
+
+      FiniteElementCollection *fec =
+         FiniteElementCollection::New(fec_name.c_str());
+      ParFiniteElementSpace *fes =
+         new ParFiniteElementSpace(&pmesh, fec, params[0],
+                                   static_cast<Ordering::Type>(params[1]));
+      ParGridFunction *gf = new ParGridFunction(fes);
+      gf->MakeOwner(fec);
+      MFEM_VERIFY(gf->Size() == size, "The mesh of " << fname
+                  << " does not match the given mesh.");
+      BitReader br(data);
+      double *x = gf->HostWrite();
+      const int block_size = params[2];
+      for (long long i = 0; i < size; i += block_size)
+      {
+         const int n = std::min<long long>(block_size, size - i);
+         DecodeBlock(br, x + i, n, tol);
+      }
+      return gf;
+   }
+   MFEM_ABORT("Field " << name << " not found in " << fname);
+   return NULL;
+}
+
+static void HostCopy(const Vector &src, Vector &dst)
+{
+   dst.SetSize(src.Size());
+   std::copy(src.HostRead(), src.HostRead() + src.Size(), dst.HostWrite());
+}
+
+AsyncWriter::AsyncWriter(ParMesh &pmesh, ParFiniteElementSpace &h1_fes,
+                         ParFiniteElementSpace &l2_fes, const char *basename,
+                         const bool visit, const bool print, const int depth)
+   : basename(basename), visit(visit), print(print), myid(pmesh.GetMyRank()),
+     H1(h1_fes), L2(l2_fes),
+     wmesh(pmesh, true),
+     visit_dc(pmesh.GetComm(), basename, &wmesh),
+     stop(false)
+{
+   MFEM_VERIFY(depth > 0, "The output queue needs at least one buffer.");
+   // The FE spaces are only read by the thread, to save the field headers.
+   rho_w.MakeRef(&L2, nullptr);
+   v_w.MakeRef(&H1, nullptr);
+   e_w.MakeRef(&L2, nullptr);
+   visit_dc.RegisterField("Density",  &rho_w);
+   visit_dc.RegisterField("Velocity", &v_w);
+   visit_dc.RegisterField("Specific Internal Energy", &e_w);
+   snapshots.SetSize(depth);
+   for (int i = 0; i < depth; i++)
+   {
+      snapshots[i] = new Snapshot;
+      free_queue.push_back(snapshots[i]);
+   }
+   thread = std::thread(&AsyncWriter::Run, this);
+}
+
+AsyncWriter::~AsyncWriter()
+{
+   {
+      std::lock_guard<std::mutex> lock(mtx);
+      stop = true;
+   }
+   cv.notify_all();
+   thread.join();
+   for (int i = 0; i < snapshots.Size(); i++) { delete snapshots[i]; }
+}
+
+void AsyncWriter::Write(const int cycle, const double time,
+                        const ParGridFunction &x, const ParGridFunction &rho,
+                        const ParGridFunction &v, const ParGridFunction &e)
+{
+   Snapshot *snap;
+   {
+      std::unique_lock<std::mutex> lock(mtx);
+      cv.wait(lock, [this] { return !free_queue.empty(); });
+      snap = free_queue.front();
+      free_queue.pop_front();
+   }
+   snap->cycle = cycle;
+   snap->time = time;
+   HostCopy(x, snap->x);
+   HostCopy(rho, snap->rho);
+   HostCopy(v, snap->v);
+   HostCopy(e, snap->e);
+   {
+      std::lock_guard<std::mutex> lock(mtx);
+      write_queue.push_back(snap);
+   }
+   cv.notify_all();
+}
+
+void AsyncWriter::Run()
+{
+   for (;;)
+   {
+      Snapshot *snap;
+      {
+         std::unique_lock<std::mutex> lock(mtx);
+         cv.wait(lock, [this] { return stop || !write_queue.empty(); });
+         if (write_queue.empty()) { return; }
+         snap = write_queue.front();
+         write_queue.pop_front();
+      }
+      Save(*snap);
+      {
+         std::lock_guard<std::mutex> lock(mtx);
+         free_queue.push_back(snap);
+      }
+      cv.notify_all();
+   }
+}
+
+void AsyncWriter::Save(Snapshot &snap)
+{
+   *wmesh.GetNodes() = snap.x;
+   rho_w.MakeRef(&L2, snap.rho, 0);
+   v_w.MakeRef(&H1, snap.v, 0);
+   e_w.MakeRef(&L2, snap.e, 0);
+
+   if (visit)
+   {
+      visit_dc.SetCycle(snap.cycle);
+      visit_dc.SetTime(snap.time);
+      visit_dc.Save();
+   }
+
+   if (print)
+   {
+      std::ostringstream mesh_name, rho_name, v_name, e_name;
+      mesh_name << basename << "_" << snap.cycle << "_mesh";
+      rho_name  << basename << "_" << snap.cycle << "_rho";
+      v_name << basename << "_" << snap.cycle << "_v";
+      e_name << basename << "_" << snap.cycle << "_e";
+
+      std::ofstream mesh_ofs(RankFileName(mesh_name.str(), myid).c_str());
+      mesh_ofs.precision(8);
+      wmesh.Print(mesh_ofs);
+      mesh_ofs.close();
+
+      std::ofstream rho_ofs(RankFileName(rho_name.str(), myid).c_str());
+      rho_ofs.precision(8);
+      rho_w.Save(rho_ofs);
+      rho_ofs.close();
+
+      std::ofstream v_ofs(RankFileName(v_name.str(), myid).c_str());
+      v_ofs.precision(8);
+      v_w.Save(v_ofs);
+      v_ofs.close();
+
+      std::ofstream e_ofs(RankFileName(e_name.str(), myid).c_str());
+      e_ofs.precision(8);
+      e_w.Save(e_ofs);
+      e_ofs.close();
+   }
+}
+
+AggregatedVisItWriter::AggregatedVisItWriter(ParMesh &pmesh,
+                                             const char *basename,
+                                             const int group_size)
+   : basename(basename)
+{
+   MFEM_VERIFY(group_size > 0, "Invalid VisIt group size " << group_size);
+   const int myid = pmesh.GetMyRank();
+   MPI_Comm_split(pmesh.GetComm(), myid / group_size, myid, &group_comm);
+   MPI_Comm_rank(group_comm, &group_rank);
+   MPI_Comm_size(group_comm, &group_nranks);
+   MPI_Comm_split(pmesh.GetComm(), group_rank == 0 ? 0 : MPI_UNDEFINED, myid,
+                  &aggr_comm);
+}
+
+AggregatedVisItWriter::~AggregatedVisItWriter()
+{
+   MPI_Comm_free(&group_comm);
+   if (aggr_comm != MPI_COMM_NULL) { MPI_Comm_free(&aggr_comm); }
+}
+
+// Point-to-point transfer of n bytes in messages of at most 1 GiB, so that the
+// int counts of MPI do not limit the size of the data.
+static const long long p2p_chunk = 1LL << 30;
+
+static void SendChunked(const void *data, const long long n, const int dest,
+                        MPI_Comm comm)
+{
+   const char *d = static_cast<const char *>(data);
+   for (long long pos = 0; pos < n; pos += p2p_chunk)
+   {
+      const int count = static_cast<int>(std::min(p2p_chunk, n - pos));
+      MPI_Send(const_cast<char *>(d + pos), count, MPI_BYTE, dest, 0, comm);
+   }
+}
+
+static void RecvChunked(void *data, const long long n, const int src,
+                        MPI_Comm comm)
+{
+   char *d = static_cast<char *>(data);
+   for (long long pos = 0; pos < n; pos += p2p_chunk)
+   {
+      const int count = static_cast<int>(std::min(p2p_chunk, n - pos));
+      MPI_Recv(d + pos, count, MPI_BYTE, src, 0, comm, MPI_STATUS_IGNORE);
+   }
+}
+
+void AggregatedVisItWriter::Save(const int cycle, const double time,
+                                 ParMesh &pmesh, const ParGridFunction &rho,
+                                 const ParGridFunction &v,
+                                 const ParGridFunction &e)
+{
+   // The local piece: the mesh arrays of GetParMeshArrays() (with the current
+   // nodes) and the binary values of the fields.
+   const int nfields = 3;
+   const ParGridFunction *fields[nfields] = { &rho, &v, &e };
+   Array<int> mesh_ints;
+   Vector mesh_reals;
+   GetParMeshArrays(pmesh, mesh_ints, mesh_reals);
+   long long sizes[2 + nfields] = { mesh_ints.Size(), mesh_reals.Size() };
+   for (int f = 0; f < nfields; f++) { sizes[2 + f] = fields[f]->Size(); }
+
+   const bool aggregator = (group_rank == 0);
+   const int nsizes = 2 + nfields;
+   std::vector<long long> all_sizes(aggregator ? nsizes * group_nranks : 0);
+   MPI_Gather(sizes, nsizes, MPI_LONG_LONG, all_sizes.data(), nsizes,
+              MPI_LONG_LONG, 0, group_comm);
+   if (!aggregator)
+   {
+      SendChunked(mesh_ints.HostRead(), sizes[0] * sizeof(int), 0,
+                  group_comm);
+      SendChunked(mesh_reals.HostRead(), sizes[1] * sizeof(double), 0,
+                  group_comm);
+      for (int f = 0; f < nfields; f++)
+      {
+         SendChunked(fields[f]->HostRead(), sizes[2 + f] * sizeof(double), 0,
+                     group_comm);
+      }
+      return;
+   }
+
+   // Rebuild the pieces of the group and merge them into one mesh and one
+   // grid function per field. All pieces use the spaces of the local fields.
+   Array<Mesh *> meshes(group_nranks);
+   Array<FiniteElementSpace *> spaces(nfields * group_nranks);
+   Array<GridFunction *> gfs(nfields * group_nranks);
+   for (int r = 0; r < group_nranks; r++)
+   {
+      const long long *rs = all_sizes.data() + nsizes * r;
+      MFEM_VERIFY(rs[0] <= INT_MAX && rs[1] <= INT_MAX,
+                  "The mesh of rank " << r << " of the group is too large.");
+      Array<int> ints(r == 0 ? 0 : rs[0]);
+      Vector reals(r == 0 ? 0 : rs[1]);
+      if (r > 0)
+      {
+         RecvChunked(ints.GetData(), rs[0] * sizeof(int), r, group_comm);
+         RecvChunked(reals.HostWrite(), rs[1] * sizeof(double), r,
+                     group_comm);
+      }
+      meshes[r] = MakeLocalMesh(r == 0 ? mesh_ints : ints,
+                                r == 0 ? mesh_reals : reals);
+      for (int f = 0; f < nfields; f++)
+      {
+         const FiniteElementSpace *fes = fields[f]->FESpace();
+         const int i = f * group_nranks + r;
+         spaces[i] = new FiniteElementSpace(meshes[r], fes->FEColl(),
+                                            fes->GetVDim(),
+                                            fes->GetOrdering());
+         gfs[i] = new GridFunction(spaces[i]);
+         MFEM_VERIFY(gfs[i]->Size() == rs[2 + f],
+                     "Field " << f << " of rank " << r << " of the group "
+                     "does not match its space.");
+         if (r == 0) { *gfs[i] = *fields[f]; }
+         else
+         {
+            RecvChunked(gfs[i]->HostWrite(), rs[2 + f] * sizeof(double), r,
+                        group_comm);
+         }
+      }
+   }
+   Mesh group_mesh(meshes.GetData(), group_nranks);
+   GridFunction rho_g(&group_mesh, gfs.GetData(), group_nranks);
+   GridFunction v_g(&group_mesh, gfs.GetData() + group_nranks, group_nranks);
+   GridFunction e_g(&group_mesh, gfs.GetData() + 2*group_nranks, group_nranks);
+   for (int i = 0; i < gfs.Size(); i++) { delete gfs[i]; delete spaces[i]; }
+   for (int r = 0; r < group_nranks; r++) { delete meshes[r]; }
+
+   VisItDataCollection visit_dc(aggr_comm, basename, &group_mesh);
+   visit_dc.RegisterField("Density",  &rho_g);
+   visit_dc.RegisterField("Velocity", &v_g);
+   visit_dc.RegisterField("Specific Internal Energy", &e_g);
+   visit_dc.SetCycle(cycle);
+   visit_dc.SetTime(time);
+   visit_dc.Save();
+}
+
+} // namespace hydrodynamics
+
+} // namespace mfem
+
+#endif // MFEM_USE_MPI
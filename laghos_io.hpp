@@ -0,0 +1,223 @@
+// Copyright (c) 2017, Lawrence Livermore National Security, LLC. Produced at
+// the Lawrence Livermore National Laboratory. LLNL-CODE-734707. All Rights
+// reserved. See files LICENSE and NOTICE for details.
+//
+// This file is part of CEED, a collection of benchmarks, miniapps, software
+// libraries and APIs for efficient high-order finite element and spectral
+// element discretizations for exascale applications. For more information and
+// source code availability see http://github.com/ceed.
+//
+// The CEED research is supported by the Exascale Computing Project 17-SC-20-SC,
+// a collaborative effort of two U.S. Department of Energy organizations (Office
+// of Science and the National Nuclear Security Administration) responsible for
+// the planning and preparation of a capable exascale ecosystem, including
+// software, applications, hardware, advanced system engineering and early
+// testbed platforms, in support of the nation's exascale computing imperative.
+
+#ifndef MFEM_LAGHOS_IO
+#define MFEM_LAGHOS_IO
+
+#include "mfem.hpp"
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#ifdef MFEM_USE_MPI
+
+namespace mfem
+{
+
+namespace hydrodynamics
+{
+
+// State of a run that is needed to resume it bit-for-bit. Each rank stores its
+// own part in a separate binary file, so no data is moved between the ranks.
+struct Checkpoint
+{
+   // Time step index, number of steps, number of passed checks (-chk), time
+   // and next time step.
+   int ti = 0, steps = 0, checks = 0;
+   double t = 0.0, dt = 0.0;
+   // Initial mesh size and the energy monitoring data.
+   double h0 = 0.0, energy_drift = 0.0;
+   // Accumulated real times and counters of TimingData: the times of the FOM
+   // phases, then the ones of the phase report of PrintPhaseTimers() and the
+   // quadrature data time of the time step estimates.
+   double timer_rt[4] = { 0.0, 0.0, 0.0, 0.0 };
+   double phase_rt[6] = { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+   long long timer_cnt[3] = { 0, 0, 0 };
+   // The local part of the state vector (x, v, e) and of the initial positions.
+   // The latter define the reference configuration of the Lagrangian mesh.
+   Vector S, x0;
+   // The local part of the ParMesh in the arrays of GetParMeshArrays(), without
+   // the nodes, which are the positions in S.
+   Array<int> mesh_ints;
+   Vector mesh_reals;
+};
+
+// Prefix of the checkpoint files of time step ti: <basename>_ckpt_<ti>.
+std::string CheckpointPrefix(const char *basename, const int ti);
+// Name of the file of the given rank in per-rank output: <prefix>.<rank>.
+std::string RankFileName(const std::string &prefix, const int rank);
+
+// Writes the checkpoint of this rank in the native binary format. The mesh
+// section is filled from pmesh. The file is written under a temporary name and
+// renamed when complete, so an interrupted write never replaces a checkpoint.
+void SaveCheckpoint(const std::string &prefix, ParMesh &pmesh,
+                    Checkpoint &ckpt);
+
+// Reads the checkpoint of this rank, written by the same number of ranks, and
+// returns the restored ParMesh. The returned mesh has no nodes: the caller
+// rebuilds them from the initial positions in ckpt.x0 and the current ones in
+// ckpt.S.
+ParMesh *LoadCheckpoint(const std::string &prefix, MPI_Comm comm,
+                        Checkpoint &ckpt);
+
+// Writes a snapshot of the given fields into a single shared binary file with
+// collective MPI-IO, as an alternative to ParMesh::PrintAsOne() and
+// ParGridFunction::SaveAsOne(), which gather all data on the root rank. The
+// file starts with a header and an index with the offset and the sizes of the
+// slice of each rank, followed by the slices: the local mesh in the binary
+// arrays of GetParMeshArrays() and the local (L-vector) values of each field.
+// The byte layout, in native byte order, is
+//   char[8]            magic "LAGHOSMP"
+//   int[4]             version (2), number of ranks, nfields, cycle
+//   double             time
+//   char[32]           zero-padded name of each field
+//   int64[3+nfields]   index entry of each rank, in rank order: byte offset of
+//                      its slice, number of mesh ints, number of mesh reals
+//                      and number of values of each field
+//   slices             in rank order: the mesh ints (int), the mesh reals
+//                      (double), then the values of each field (double)
+// No text is formatted: the mesh nodes are stored as raw doubles among the
+// mesh reals, and the topology as raw ints.
+void SaveSnapshotMPIIO(const std::string &fname, const ParMesh &pmesh,
+                       const double time, const int cycle, const int nfields,
+                       const char *const names[],
+                       const ParGridFunction *const fields[]);
+
+// Reads the ParMesh from a file written by SaveSnapshotMPIIO() with the same
+// number of ranks. Each rank reads only its own slice and rebuilds its part of
+// the mesh from the arrays with MakeParMesh(). With nfields = 0, the two
+// functions store and restore a partitioned mesh.
+ParMesh *LoadSnapshotMeshMPIIO(const std::string &fname, MPI_Comm comm);
+
+// Reads the local values of the named field of this rank from a file written
+// by SaveSnapshotMPIIO() with the same number of ranks, into the L-vector of
+// the field on the mesh returned by LoadSnapshotMeshMPIIO().
+void LoadSnapshotFieldMPIIO(const std::string &fname, MPI_Comm comm,
+                            const std::string &name, Vector &values);
+
+// Error-bounded lossy compression of the local values of grid functions. The
+// values are quantized to integer multiples of 2*tol, where tol is the given
+// absolute tolerance or rel_tol times the maximum magnitude of the field over
+// all ranks (the smaller of the two when both are positive), so the error of
+// each reconstructed value is at most tol. The quantized values are split into
+// blocks, of whole elements for the discontinuous (L2) fields and of fixed
+// ranges of the local dofs for the others, such as the H1 positions and
+// velocities, whose values are not stored element by element. Each value is
+// predicted from the previous one in its block and entropy coded with a
+// Golomb-Rice code whose parameter is chosen per block. Blocks that cannot be
+// quantized are stored uncompressed. Each rank writes the fields into the file
+// <prefix>.<rank>, and returns the number of bytes written. Collective on the
+// communicator of pmesh.
+long long SaveCompressed(const std::string &prefix, const ParMesh &pmesh,
+                         const double time, const int cycle,
+                         const double abs_tol, const double rel_tol,
+                         const int nfields, const char *const names[],
+                         const ParGridFunction *const fields[]);
+
+// Reads the named field of this rank from a file written by SaveCompressed()
+// and returns it on a new space on pmesh, which must have the partitioning of
+// the writing run, e.g. read from the ParMesh::ParPrint() output of its mesh.
+ParGridFunction *LoadCompressed(const std::string &prefix, ParMesh &pmesh,
+                                const std::string &name, double *time = NULL,
+                                int *cycle = NULL);
+
+// Asynchronous output of the VisIt and -print files of a rank. Write() copies
+// the positions and the fields into one of 'depth' preallocated snapshot
+// buffers and queues it for a background thread, which saves the files while
+// the time stepping continues. When all buffers are in use, Write() blocks
+// until the oldest snapshot is written, so the memory use stays bounded.
+//
+// The background thread does no MPI communication. It saves a local copy of
+// the mesh of the rank: VisIt output has the usual directory structure with
+// one mesh file per rank, and -print output uses the per-rank MFEM format
+// (<basename>_<cycle>_mesh.<rank>, readable by glvis -np).
+class AsyncWriter
+{
+private:
+   struct Snapshot
+   {
+      int cycle;
+      double time;
+      Vector x, rho, v, e;
+   };
+
+   const std::string basename;
+   const bool visit, print;
+   const int myid;
+   FiniteElementSpace &H1, &L2;
+
+   // Local copy of the mesh, whose nodes are set from each snapshot, and the
+   // fields that are saved, which refer to the snapshot data.
+   Mesh wmesh;
+   GridFunction rho_w, v_w, e_w;
+   VisItDataCollection visit_dc;
+
+   Array<Snapshot *> snapshots;
+   std::deque<Snapshot *> free_queue, write_queue;
+   std::mutex mtx;
+   std::condition_variable cv;
+   bool stop;
+   std::thread thread;
+
+   void Run();
+   void Save(Snapshot &snap);
+
+public:
+   AsyncWriter(ParMesh &pmesh, ParFiniteElementSpace &h1_fes,
+               ParFiniteElementSpace &l2_fes, const char *basename,
+               const bool visit, const bool print, const int depth);
+   // Writes all queued snapshots and stops the thread.
+   ~AsyncWriter();
+
+   void Write(const int cycle, const double time, const ParGridFunction &x,
+              const ParGridFunction &rho, const ParGridFunction &v,
+              const ParGridFunction &e);
+};
+
+// N-to-M VisIt output. The ranks are split into groups of group_size
+// consecutive ranks, and each group writes a single VisIt domain: the ranks
+// send their local mesh arrays and field values, in binary messages of bounded
+// size, to the first rank of the group, which merges the pieces and writes
+// them with a VisItDataCollection defined on the communicator of the
+// aggregating ranks. The number of files per cycle is thus
+// reduced by the group size, while the output remains readable by VisIt.
+class AggregatedVisItWriter
+{
+private:
+   const std::string basename;
+   MPI_Comm group_comm, aggr_comm;
+   int group_rank, group_nranks;
+
+public:
+   AggregatedVisItWriter(ParMesh &pmesh, const char *basename,
+                         const int group_size);
+   ~AggregatedVisItWriter();
+
+   // Collective on the communicator of pmesh.
+   void Save(const int cycle, const double time, ParMesh &pmesh,
+             const ParGridFunction &rho, const ParGridFunction &v,
+             const ParGridFunction &e);
+};
+
+} // namespace hydrodynamics
+
+} // namespace mfem
+
+#endif // MFEM_USE_MPI
+
+#endif // MFEM_LAGHOS_IO
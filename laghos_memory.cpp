@@ -0,0 +1,155 @@
+// Copyright (c) 2017, Lawrence Livermore National Security, LLC. Produced at
+// the Lawrence Livermore National Laboratory. LLNL-CODE-734707. All Rights
+// reserved. See files LICENSE and NOTICE for details.
+//
+// This file is part of CEED, a collection of benchmarks, miniapps, software
+// libraries and APIs for efficient high-order finite element and spectral
+// element discretizations for exascale applications. For more information and
+// source code availability see http://github.com/ceed.
+//
+// The CEED research is supported by the Exascale Computing Project 17-SC-20-SC,
+// a collaborative effort of two U.S. Department of Energy organizations (Office
+// of Science and the National Nuclear Security Administration) responsible for
+// the planning and preparation of a capable exascale ecosystem, including
+// software, applications, hardware, advanced system engineering and early
+// testbed platforms, in support of the nation's exascale computing imperative.
+
+#include "laghos_memory.hpp"
+#include "laghos_assembly.hpp"
+#include <algorithm>
+#include <sys/mman.h>
+
+namespace mfem
+{
+
+namespace hydrodynamics
+{
+
+static const size_t huge_page_size = 2 << 20;
+
+double *ZoneMemory::Allocate(const size_t n)
+{
+   MFEM_VERIFY(!Device::Allows(Backend::DEVICE_MASK),
+               "The zone memory placement is only available on the host.");
+   // Fresh anonymous pages, which are placed on their first write.
+   const size_t bytes = std::max(n, size_t(1)) * sizeof(double) +
+                        (huge_pages ? huge_page_size : 0);
+   void *ptr = mmap(NULL, bytes, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+   MFEM_VERIFY(ptr != MAP_FAILED, "Cannot allocate " << bytes << " bytes.");
+   blocks.push_back(std::make_pair(ptr, bytes));
+   char *data = static_cast<char *>(ptr);
+   if (huge_pages)
+   {
+      const size_t addr = reinterpret_cast<size_t>(data);
+      data += (huge_page_size - addr % huge_page_size) % huge_page_size;
+#ifdef MADV_HUGEPAGE
+      madvise(data, bytes - (data - static_cast<char *>(ptr)), MADV_HUGEPAGE);
+#endif
+   }
+   return reinterpret_cast<double *>(data);
+}
+
+ZoneMemory::~ZoneMemory()
+{
+   for (size_t i = 0; i < blocks.size(); i++)
+   {
+      munmap(blocks[i].first, blocks[i].second);
+   }
+}
+
+// Copies src into dst, where the first write of each zone block is done by the
+// thread that processes the zone.
+static void FirstTouchCopy(const double *src, double *dst, const size_t size,
+                           const int NE, const int nslabs)
+{
+   const size_t nblocks = static_cast<size_t>(nslabs) * NE;
+   const size_t chunk = (nblocks > 0) ? size / nblocks : 0;
+   LAGHOS_OMP(parallel for schedule(static))
+   for (int e = 0; e < NE; e++)
+   {
+      for (int s = 0; s < nslabs; s++)
+      {
+         const size_t o = (static_cast<size_t>(s) * NE + e) * chunk;
+         std::copy(src + o, src + o + chunk, dst + o);
+      }
+   }
+   std::copy(src + nblocks * chunk, src + size, dst + nblocks * chunk);
+}
+
+// Same for an L-vector of fes, whose dofs are not ordered by zones: each dof is
+// copied by the thread of the first zone that contains it.
+static void FirstTouchCopy(const double *src, double *dst,
+                           const FiniteElementSpace &fes)
+{
+   const int NE = fes.GetNE(), size = fes.GetVSize();
+   Array<int> zone(size), vdofs;
+   zone = -1;
+   for (int e = 0; e < NE; e++)
+   {
+      fes.GetElementVDofs(e, vdofs);
+      for (int j = 0; j < vdofs.Size(); j++)
+      {
+         const int d = (vdofs[j] >= 0) ? vdofs[j] : -1 - vdofs[j];
+         if (zone[d] < 0) { zone[d] = e; }
+      }
+   }
+   // The dofs of each zone, in CSR format.
+   Array<int> I(NE + 1), J(size);
+   I = 0;
+   for (int d = 0; d < size; d++)
+   {
+      if (zone[d] >= 0) { I[zone[d] + 1]++; }
+   }
+   I.PartialSum();
+   Array<int> pos(I);
+   for (int d = 0; d < size; d++)
+   {
+      if (zone[d] >= 0) { J[pos[zone[d]]++] = d; }
+   }
+   LAGHOS_OMP(parallel for schedule(static))
+   for (int e = 0; e < NE; e++)
+   {
+      for (int k = I[e]; k < I[e + 1]; k++) { dst[J[k]] = src[J[k]]; }
+   }
+   for (int d = 0; d < size; d++)
+   {
+      if (zone[d] < 0) { dst[d] = src[d]; }
+   }
+}
+
+void ZoneMemory::Place(Vector &v, const int NE, const int nslabs)
+{
+   const int n = v.Size();
+   double *data = Allocate(n);
+   FirstTouchCopy(v.HostRead(), data, n, NE, nslabs);
+   v.NewDataAndSize(data, n);
+}
+
+void ZoneMemory::Place(DenseTensor &t, const int NE, const int nslabs)
+{
+   const int n = t.TotalSize();
+   double *data = Allocate(n);
+   FirstTouchCopy(t.HostRead(), data, n, NE, nslabs);
+   const int h = t.SizeI(), w = t.SizeJ(), k = t.SizeK();
+   t.GetMemory().Delete();
+   t.UseExternalData(data, h, w, k);
+}
+
+void ZoneMemory::Place(BlockVector &v, const Array<int> &offsets,
+                       const Array<const FiniteElementSpace *> &spaces)
+{
+   double *data = Allocate(v.Size());
+   const double *src = v.HostRead();
+   for (int b = 0; b + 1 < offsets.Size(); b++)
+   {
+      MFEM_VERIFY(spaces[b]->GetVSize() == offsets[b + 1] - offsets[b],
+                  "Block " << b << " does not match its space.");
+      FirstTouchCopy(src + offsets[b], data + offsets[b], *spaces[b]);
+   }
+   v.Update(data, offsets);
+}
+
+} // namespace hydrodynamics
+
+} // namespace mfem
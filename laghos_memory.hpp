@@ -0,0 +1,65 @@
+// Copyright (c) 2017, Lawrence Livermore National Security, LLC. Produced at
+// the Lawrence Livermore National Laboratory. LLNL-CODE-734707. All Rights
+// reserved. See files LICENSE and NOTICE for details.
+//
+// This file is part of CEED, a collection of benchmarks, miniapps, software
+// libraries and APIs for efficient high-order finite element and spectral
+// element discretizations for exascale applications. For more information and
+// source code availability see http://github.com/ceed.
+//
+// The CEED research is supported by the Exascale Computing Project 17-SC-20-SC,
+// a collaborative effort of two U.S. Department of Energy organizations (Office
+// of Science and the National Nuclear Security Administration) responsible for
+// the planning and preparation of a capable exascale ecosystem, including
+// software, applications, hardware, advanced system engineering and early
+// testbed platforms, in support of the nation's exascale computing imperative.
+
+#ifndef MFEM_LAGHOS_MEMORY
+#define MFEM_LAGHOS_MEMORY
+
+#include "mfem.hpp"
+#include <cstddef>
+#include <vector>
+
+namespace mfem
+{
+
+namespace hydrodynamics
+{
+
+// Host memory for the arrays that are processed zone by zone. On NUMA nodes,
+// a page is placed in the memory of the socket of the thread that first writes
+// it. The arrays are therefore copied into fresh pages with the static schedule
+// over the zones of the threaded loops, so each thread later accesses the
+// memory of its own socket. Optionally, the pages are 2 MB aligned and advised
+// as transparent huge pages, which reduces the TLB misses of the kernels.
+// The memory is released by the destructor, after the last use of the arrays.
+class ZoneMemory
+{
+private:
+   const bool huge_pages;
+   std::vector<std::pair<void *, size_t> > blocks;
+
+   double *Allocate(const size_t n);
+
+public:
+   ZoneMemory(const bool huge_pages) : huge_pages(huge_pages) { }
+   ~ZoneMemory();
+
+   // Moves the values of v into first-touched memory. The array consists of
+   // nslabs slabs of NE zone blocks of the same size, e.g., nslabs = 1 for the
+   // E-vectors and the quadrature data ordered by zones.
+   void Place(Vector &v, const int NE, const int nslabs = 1);
+   void Place(DenseTensor &t, const int NE, const int nslabs = 1);
+   // Same for the blocks of a BlockVector, whose blocks are updated. Block b
+   // is an L-vector of spaces[b], e.g., a byNODES H1 vector, and each of its
+   // dofs is first written by the thread of the first zone that contains it.
+   void Place(BlockVector &v, const Array<int> &offsets,
+              const Array<const FiniteElementSpace *> &spaces);
+};
+
+} // namespace hydrodynamics
+
+} // namespace mfem
+
+#endif // MFEM_LAGHOS_MEMORY
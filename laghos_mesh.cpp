@@ -0,0 +1,799 @@
+// Copyright (c) 2017, Lawrence Livermore National Security, LLC. Produced at
+// the Lawrence Livermore National Laboratory. LLNL-CODE-734707. All Rights
+// reserved. See files LICENSE and NOTICE for details.
+//
+// This file is part of CEED, a collection of benchmarks, miniapps, software
+// libraries and APIs for efficient high-order finite element and spectral
+// element discretizations for exascale applications. For more information and
+// source code availability see http://github.com/ceed.
+//
+// The CEED research is supported by the Exascale Computing Project 17-SC-20-SC,
+// a collaborative effort of two U.S. Department of Energy organizations (Office
+// of Science and the National Nuclear Security Administration) responsible for
+// the planning and preparation of a capable exascale ecosystem, including
+// software, applications, hardware, advanced system engineering and early
+// testbed platforms, in support of the nation's exascale computing imperative.
+
+#include "laghos_mesh.hpp"
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef MFEM_USE_MPI
+
+namespace mfem
+{
+
+namespace hydrodynamics
+{
+
+// First zone of block p, when n zones are split into c blocks.
+static int BlockStart(const int n, const int c, const int p)
+{
+   return static_cast<int>(static_cast<long long>(n) * p / c);
+}
+
+// Block that contains zone z.
+static int ZoneBlock(const int n, const int c, const int z)
+{
+   int p = static_cast<int>(static_cast<long long>(z) * c / n);
+   while (p > 0 && BlockStart(n, c, p) > z) { p--; }
+   while (p < c - 1 && BlockStart(n, c, p + 1) <= z) { p++; }
+   return p;
+}
+
+// Blocks whose closure contains grid point i: two on the interfaces between
+// blocks, one otherwise.
+static int PointBlocks(const int n, const int c, const int i, int p[2])
+{
+   if (i == n) { p[0] = c - 1; return 1; }
+   const int q = ZoneBlock(n, c, i);
+   if (q > 0 && BlockStart(n, c, q) == i)
+   {
+      p[0] = q - 1; p[1] = q;
+      return 2;
+   }
+   p[0] = q;
+   return 1;
+}
+
+// Shared entities of one communication group, as local vertex indices.
+struct SharedGroup
+{
+   std::vector<int> vertices, edges, faces;
+};
+
+void WriteCartesianMeshPiece(std::ostream &os, const int myid,
+                             const Array<int> &nxyz, const Array<int> &cxyz,
+                             const Vector &lxyz)
+{
+   const int dim = nxyz.Size();
+   MFEM_VERIFY(dim >= 1 && dim <= 3 && cxyz.Size() == dim &&
+               lxyz.Size() == dim, "Invalid Cartesian mesh specification.");
+
+   // Number of zones n and of blocks c, block coordinates p, first zone o and
+   // number of zones of the local block in each direction. The unused
+   // directions have a single vertex.
+   int n[3] = {1, 1, 1}, c[3] = {1, 1, 1}, p[3] = {0, 0, 0}, o[3] = {0, 0, 0};
+   int nz[3] = {1, 1, 1}, nv[3] = {1, 1, 1};
+   int rest = myid;
+   for (int d = 0; d < dim; d++)
+   {
+      n[d] = nxyz[d];
+      c[d] = cxyz[d];
+      MFEM_VERIFY(c[d] >= 1 && n[d] >= c[d], "Cannot split " << n[d]
+                  << " zones into " << c[d] << " blocks.");
+      p[d] = rest % c[d];
+      rest /= c[d];
+      o[d] = BlockStart(n[d], c[d], p[d]);
+      nz[d] = BlockStart(n[d], c[d], p[d] + 1) - o[d];
+      nv[d] = nz[d] + 1;
+   }
+   MFEM_VERIFY(rest == 0, "Rank " << myid << " is outside the rank grid.");
+   auto V = [&](const int i, const int j, const int k)
+   { return i + nv[0] * (j + nv[1] * k); };
+
+   // Vertices of the zones and boundary faces of the zones in the order of
+   // the reference elements: zone vertices, normal direction and side.
+   static const int corner[8][3] =
+   {
+      {0,0,0}, {1,0,0}, {1,1,0}, {0,1,0}, {0,0,1}, {1,0,1}, {1,1,1}, {0,1,1}
+   };
+   struct BdrFace { int v[4], dir, side; };
+   static const BdrFace bdr_1D[2] = { {{0}, 0, 0}, {{1}, 0, 1} };
+   static const BdrFace bdr_2D[4] =
+   {
+      {{0,1}, 1, 0}, {{1,2}, 0, 1}, {{2,3}, 1, 1}, {{3,0}, 0, 0}
+   };
+   static const BdrFace bdr_3D[6] =
+   {
+      {{3,2,1,0}, 2, 0}, {{0,1,5,4}, 1, 0}, {{1,2,6,5}, 0, 1},
+      {{2,3,7,6}, 1, 1}, {{3,0,4,7}, 0, 0}, {{4,5,6,7}, 2, 1}
+   };
+   const BdrFace *bdr = (dim == 1) ? bdr_1D : (dim == 2) ? bdr_2D : bdr_3D;
+   const int geom[4] = { Geometry::POINT, Geometry::SEGMENT, Geometry::SQUARE,
+                         Geometry::CUBE
+                       };
+   const int zone_nv = 1 << dim, face_nv = zone_nv / 2, nfaces = 2 * dim;
+
+   os.precision(16);
+   os << "MFEM mesh v1.2\n\ndimension\n" << dim << "\n\nelements\n"
+      << nz[0] * nz[1] * nz[2] << '\n';
+   std::ostringstream bdr_os;
+   int nbdr = 0;
+   for (int k = 0; k < nz[2]; k++)
+   {
+      for (int j = 0; j < nz[1]; j++)
+      {
+         for (int i = 0; i < nz[0]; i++)
+         {
+            const int z[3] = { i, j, k };
+            int zv[8];
+            for (int v = 0; v < zone_nv; v++)
+            {
+               zv[v] = V(i + corner[v][0], j + corner[v][1], k + corner[v][2]);
+            }
+            os << "1 " << geom[dim];
+            for (int v = 0; v < zone_nv; v++) { os << ' ' << zv[v]; }
+            os << '\n';
+            for (int f = 0; f < nfaces; f++)
+            {
+               const int d = bdr[f].dir;
+               const bool on_bdr = (bdr[f].side == 0) ?
+                                   (p[d] == 0 && z[d] == 0) :
+                                   (p[d] == c[d] - 1 && z[d] == nz[d] - 1);
+               if (!on_bdr) { continue; }
+               bdr_os << d + 1 << ' ' << geom[dim - 1];
+               for (int v = 0; v < face_nv; v++)
+               {
+                  bdr_os << ' ' << zv[bdr[f].v[v]];
+               }
+               bdr_os << '\n';
+               nbdr++;
+            }
+         }
+      }
+   }
+   os << "\nboundary\n" << nbdr << '\n' << bdr_os.str();
+
+   os << "\nvertices\n" << nv[0] * nv[1] * nv[2] << '\n' << dim << '\n';
+   for (int k = 0; k < nv[2]; k++)
+   {
+      for (int j = 0; j < nv[1]; j++)
+      {
+         for (int i = 0; i < nv[0]; i++)
+         {
+            const int g[3] = { o[0] + i, o[1] + j, o[2] + k };
+            for (int d = 0; d < dim; d++)
+            {
+               os << (d > 0 ? " " : "") << g[d] * lxyz(d) / n[d];
+            }
+            os << '\n';
+         }
+      }
+   }
+   os << "\nmfem_serial_mesh_end\n";
+
+   // Shared vertices, edges and faces, grouped by the set of ranks whose
+   // blocks contain them. The entities are visited by type (given by the
+   // mask of the directions along which they extend) and then in increasing
+   // global order, which is the same on all ranks of a group.
+   std::map<std::vector<int>, SharedGroup> groups;
+   for (int mask = 0; mask < zone_nv - 1; mask++)
+   {
+      int ext[3], ne[3];
+      for (int d = 0; d < 3; d++)
+      {
+         ext[d] = (d < dim) && ((mask >> d) & 1);
+         ne[d] = ext[d] ? nz[d] : nv[d];
+      }
+      for (int k = 0; k < ne[2]; k++)
+      {
+         for (int j = 0; j < ne[1]; j++)
+         {
+            for (int i = 0; i < ne[0]; i++)
+            {
+               const int e[3] = { i, j, k };
+               int blocks[3][2], nb[3];
+               bool shared = false;
+               for (int d = 0; d < 3; d++)
+               {
+                  if (d >= dim) { blocks[d][0] = 0; nb[d] = 1; continue; }
+                  const int g = o[d] + e[d];
+                  if (ext[d]) { blocks[d][0] = p[d]; nb[d] = 1; }
+                  else { nb[d] = PointBlocks(n[d], c[d], g, blocks[d]); }
+                  shared = shared || (nb[d] > 1);
+               }
+               if (!shared) { continue; }
+
+               std::vector<int> ranks;
+               for (int b2 = 0; b2 < nb[2]; b2++)
+               {
+                  for (int b1 = 0; b1 < nb[1]; b1++)
+                  {
+                     for (int b0 = 0; b0 < nb[0]; b0++)
+                     {
+                        ranks.push_back(blocks[0][b0] + c[0] *
+                                        (blocks[1][b1] + c[1] * blocks[2][b2]));
+                     }
+                  }
+               }
+               // The vertices of the entity: the first one, followed by the
+               // next ones along the directions of extension, in cyclic order.
+               int dirs[2], ndirs = 0;
+               for (int d = 0; d < dim; d++)
+               {
+                  if (ext[d]) { dirs[ndirs++] = d; }
+               }
+               const int step[3] = { 1, nv[0], nv[0] * nv[1] };
+               const int v0 = V(i, j, k);
+               SharedGroup &group = groups[ranks];
+               if (ndirs == 0) { group.vertices.push_back(v0); }
+               else if (ndirs == 1)
+               {
+                  group.edges.push_back(v0);
+                  group.edges.push_back(v0 + step[dirs[0]]);
+               }
+               else
+               {
+                  group.faces.push_back(v0);
+                  group.faces.push_back(v0 + step[dirs[0]]);
+                  group.faces.push_back(v0 + step[dirs[0]] + step[dirs[1]]);
+                  group.faces.push_back(v0 + step[dirs[1]]);
+               }
+            }
+         }
+      }
+   }
+
+   int nsv = 0, nse = 0, nsf = 0;
+   os << "\ncommunication_groups\nnumber_of_groups " << groups.size() + 1
+      << "\n\n# number of entities in each group, followed by group ids in"
+      << " group\n1 " << myid << '\n';
+   for (auto &g : groups)
+   {
+      os << g.first.size();
+      for (const int r : g.first) { os << ' ' << r; }
+      os << '\n';
+      nsv += g.second.vertices.size();
+      nse += g.second.edges.size() / 2;
+      nsf += g.second.faces.size() / 4;
+   }
+   os << "\ntotal_shared_vertices " << nsv << '\n';
+   if (dim >= 2) { os << "total_shared_edges " << nse << '\n'; }
+   if (dim >= 3) { os << "total_shared_faces " << nsf << '\n'; }
+   int gr = 1;
+   for (auto &g : groups)
+   {
+      const SharedGroup &sg = g.second;
+      os << "\n#group " << gr++ << "\nshared_vertices " << sg.vertices.size()
+         << '\n';
+      for (const int v : sg.vertices) { os << v << '\n'; }
+      if (dim >= 2)
+      {
+         os << "\nshared_edges " << sg.edges.size() / 2 << '\n';
+         for (size_t s = 0; s < sg.edges.size(); s += 2)
+         {
+            os << sg.edges[s] << ' ' << sg.edges[s+1] << '\n';
+         }
+      }
+      if (dim >= 3)
+      {
+         os << "\nshared_faces " << sg.faces.size() / 4 << '\n';
+         for (size_t s = 0; s < sg.faces.size(); s += 4)
+         {
+            os << Geometry::SQUARE << ' ' << sg.faces[s] << ' '
+               << sg.faces[s+1] << ' ' << sg.faces[s+2] << ' '
+               << sg.faces[s+3] << '\n';
+         }
+      }
+   }
+   os << "\nmfem_mesh_end" << std::endl;
+}
+
+ParMesh *MakeCartesianParMesh(MPI_Comm comm, const Array<int> &nxyz,
+                              const Array<int> &cxyz, const Vector &lxyz)
+{
+   int nranks, myid;
+   MPI_Comm_size(comm, &nranks);
+   MPI_Comm_rank(comm, &myid);
+   int nblocks = 1;
+   for (int d = 0; d < cxyz.Size(); d++) { nblocks *= cxyz[d]; }
+   MFEM_VERIFY(nblocks == nranks, "The Cartesian rank grid has " << nblocks
+               << " blocks for " << nranks << " ranks.");
+   // The piece goes through text in memory: the ParMesh(comm, istream)
+   // constructor is the only public way in MFEM to build a ParMesh from local
+   // parts with their shared entities, and filling the protected members of
+   // ParMesh directly would depend on its internals. The text is linear in the
+   // local number of zones, so the setup still scales.
+   std::stringstream piece;
+   WriteCartesianMeshPiece(piece, myid, nxyz, cxyz, lxyz);
+   return new ParMesh(comm, piece);
+}
+
+// Converts the coordinates X[0..n-1], with b bits each, into the transposed
+// Hilbert index, see J. Skilling, "Programming the Hilbert curve", AIP
+// Conference Proceedings 707, 2004.
+static void HilbertTranspose(unsigned *X, const int b, const int n)
+{
+   const unsigned M = 1u << (b - 1);
+   for (unsigned Q = M; Q > 1; Q >>= 1)
+   {
+      const unsigned P = Q - 1;
+      for (int i = 0; i < n; i++)
+      {
+         if (X[i] & Q) { X[0] ^= P; }
+         else
+         {
+            const unsigned t = (X[0] ^ X[i]) & P;
+            X[0] ^= t;
+            X[i] ^= t;
+         }
+      }
+   }
+   for (int i = 1; i < n; i++) { X[i] ^= X[i-1]; }
+   unsigned t = 0;
+   for (unsigned Q = M; Q > 1; Q >>= 1)
+   {
+      if (X[n-1] & Q) { t ^= Q - 1; }
+   }
+   for (int i = 0; i < n; i++) { X[i] ^= t; }
+}
+
+// Interleaves the bits of X[0..n-1], most significant first.
+static unsigned long long InterleaveBits(const unsigned *X, const int b,
+                                         const int n)
+{
+   unsigned long long key = 0;
+   for (int q = b - 1; q >= 0; q--)
+   {
+      for (int i = 0; i < n; i++) { key = (key << 1) | ((X[i] >> q) & 1u); }
+   }
+   return key;
+}
+
+int *SpaceFillingCurvePartitioning(MPI_Comm comm, Mesh &mesh,
+                                   const bool hilbert)
+{
+   typedef std::pair<unsigned long long, int> Key;
+   int nranks, myid;
+   MPI_Comm_size(comm, &nranks);
+   MPI_Comm_rank(comm, &myid);
+   const int NE = mesh.GetNE(), sdim = mesh.SpaceDimension();
+   MFEM_VERIFY(NE >= nranks, "The mesh has fewer zones (" << NE
+               << ") than ranks (" << nranks << ").");
+   MFEM_VERIFY(sdim <= 3, "Invalid space dimension " << sdim);
+   const int e0 = BlockStart(NE, nranks, myid);
+   const int e1 = BlockStart(NE, nranks, myid + 1);
+
+   // Element centers of the local slice and their global bounding box.
+   DenseMatrix centers(sdim, e1 - e0);
+   double box[6];
+   for (int d = 0; d < sdim; d++)
+   {
+      box[d] = box[3 + d] = -std::numeric_limits<double>::infinity();
+   }
+   Vector c;
+   for (int e = e0; e < e1; e++)
+   {
+      centers.GetColumnReference(e - e0, c);
+      mesh.GetElementCenter(e, c);
+      for (int d = 0; d < sdim; d++)
+      {
+         box[d] = std::max(box[d], -c(d));
+         box[3 + d] = std::max(box[3 + d], c(d));
+      }
+   }
+   MPI_Allreduce(MPI_IN_PLACE, box, 6, MPI_DOUBLE, MPI_MAX, comm);
+
+   // Keys of the local slice, with the element index to break ties, so all
+   // ranks obtain the same order.
+   const int b = std::min(63 / sdim, 31);
+   const double scale = static_cast<double>((1u << b) - 1);
+   std::vector<Key> keys(e1 - e0);
+   for (int e = e0; e < e1; e++)
+   {
+      unsigned X[3];
+      for (int d = 0; d < sdim; d++)
+      {
+         const double lo = -box[d], len = box[3 + d] + box[d];
+         const double t = (len > 0.0) ? (centers(d, e - e0) - lo) / len : 0.0;
+         X[d] = static_cast<unsigned>(std::min(std::max(t, 0.0), 1.0) * scale);
+      }
+      if (hilbert && sdim > 1) { HilbertTranspose(X, b, sdim); }
+      keys[e - e0] = Key(InterleaveBits(X, b, sdim), e);
+   }
+   std::sort(keys.begin(), keys.end());
+
+   // Sample sort of the keys: regular samples of the sorted slices define
+   // nranks - 1 splitters, and the keys are exchanged so that rank p holds the
+   // bucket of the keys between splitters p - 1 and p.
+   const int nloc = e1 - e0;
+   std::vector<unsigned long long> smp_k(nranks - 1), all_smp_k;
+   std::vector<int> smp_e(nranks - 1), all_smp_e;
+   for (int i = 0; i < nranks - 1; i++)
+   {
+      const Key &k = keys[static_cast<long long>(i + 1) * nloc / nranks];
+      smp_k[i] = k.first;
+      smp_e[i] = k.second;
+   }
+   all_smp_k.resize(static_cast<size_t>(nranks) * (nranks - 1));
+   all_smp_e.resize(all_smp_k.size());
+   MPI_Allgather(smp_k.data(), nranks - 1, MPI_UNSIGNED_LONG_LONG,
+                 all_smp_k.data(), nranks - 1, MPI_UNSIGNED_LONG_LONG, comm);
+   MPI_Allgather(smp_e.data(), nranks - 1, MPI_INT, all_smp_e.data(),
+                 nranks - 1, MPI_INT, comm);
+   std::vector<Key> samples(all_smp_k.size());
+   for (size_t i = 0; i < samples.size(); i++)
+   {
+      samples[i] = Key(all_smp_k[i], all_smp_e[i]);
+   }
+   std::sort(samples.begin(), samples.end());
+   std::vector<Key> splitters(nranks - 1);
+   for (int i = 0; i < nranks - 1; i++)
+   {
+      splitters[i] = samples[static_cast<size_t>(i + 1) * (nranks - 1)];
+   }
+
+   Array<int> send_cnt(nranks), send_dsp(nranks);
+   Array<int> recv_cnt(nranks), recv_dsp(nranks);
+   int pos = 0;
+   for (int p = 0; p < nranks; p++)
+   {
+      const int end = (p < nranks - 1) ?
+                      std::lower_bound(keys.begin() + pos, keys.end(),
+                                       splitters[p]) - keys.begin() : nloc;
+      send_dsp[p] = pos;
+      send_cnt[p] = end - pos;
+      pos = end;
+   }
+   MPI_Alltoall(send_cnt.GetData(), 1, MPI_INT, recv_cnt.GetData(), 1,
+                MPI_INT, comm);
+   int nbucket = 0;
+   for (int p = 0; p < nranks; p++)
+   {
+      recv_dsp[p] = nbucket;
+      nbucket += recv_cnt[p];
+   }
+   std::vector<unsigned long long> loc_k(nloc), bkt_k(nbucket);
+   std::vector<int> loc_e(nloc), bkt_e(nbucket);
+   for (int i = 0; i < nloc; i++)
+   {
+      loc_k[i] = keys[i].first;
+      loc_e[i] = keys[i].second;
+   }
+   MPI_Alltoallv(loc_k.data(), send_cnt.GetData(), send_dsp.GetData(),
+                 MPI_UNSIGNED_LONG_LONG, bkt_k.data(), recv_cnt.GetData(),
+                 recv_dsp.GetData(), MPI_UNSIGNED_LONG_LONG, comm);
+   MPI_Alltoallv(loc_e.data(), send_cnt.GetData(), send_dsp.GetData(),
+                 MPI_INT, bkt_e.data(), recv_cnt.GetData(),
+                 recv_dsp.GetData(), MPI_INT, comm);
+   keys.resize(nbucket);
+   for (int i = 0; i < nbucket; i++) { keys[i] = Key(bkt_k[i], bkt_e[i]); }
+   std::sort(keys.begin(), keys.end());
+
+   // Rank p gets the elements at the curve positions of block p. Every rank
+   // needs the whole partitioning array for the ParMesh constructor, so the
+   // parts of the buckets are combined with a reduction.
+   int offset = 0;
+   MPI_Exscan(&nbucket, &offset, 1, MPI_INT, MPI_SUM, comm);
+   if (myid == 0) { offset = 0; }
+   int *partitioning = new int[NE];
+   std::fill(partitioning, partitioning + NE, 0);
+   for (int i = 0; i < nbucket; i++)
+   {
+      partitioning[keys[i].second] = ZoneBlock(NE, nranks, offset + i);
+   }
+   MPI_Allreduce(MPI_IN_PLACE, partitioning, NE, MPI_INT, MPI_MAX, comm);
+   return partitioning;
+}
+
+// Integer array of GetParMeshArrays():
+//   int[11]   dim, space dim, number of vertices, elements, boundary elements
+//             and groups, nodes flag, and the total number of shared
+//             vertices, edges, triangles and quadrilaterals
+//   elements  attribute, geometry and vertices of each element
+//   boundary  attribute, geometry and vertices of each boundary element
+//   groups    for each group but the first (this rank alone): its number of
+//             ranks and the sorted ranks
+//   shared    for each group but the first: the number of shared vertices and
+//             their local indices, the number of shared edges and their two
+//             vertices, the number of shared triangles and their three
+//             vertices, the number of shared quadrilaterals and their four
+//             vertices, in the orientation of the group
+//   nodes     with nodes: vdim, ordering, the length of the name of the finite
+//             element collection and its characters
+// The real array holds the vertex coordinates, followed by the nodes, if any.
+static const int mesh_header_ints = 11;
+
+void GetParMeshArrays(ParMesh &pmesh, Array<int> &ints, Vector &reals,
+                      const bool with_nodes)
+{
+   MFEM_VERIFY(pmesh.Conforming(), "Only conforming meshes are supported.");
+   const int dim = pmesh.Dimension(), sdim = pmesh.SpaceDimension();
+   const int ngroups = pmesh.GetNGroups();
+   const GridFunction *nodes = with_nodes ? pmesh.GetNodes() : nullptr;
+   int nsv = 0, nse = 0, nst = 0, nsq = 0;
+   for (int g = 1; g < ngroups; g++)
+   {
+      nsv += pmesh.GroupNVertices(g);
+      nse += pmesh.GroupNEdges(g);
+      nst += pmesh.GroupNTriangles(g);
+      nsq += pmesh.GroupNQuadrilaterals(g);
+   }
+   ints.SetSize(0);
+   ints.Append(dim);
+   ints.Append(sdim);
+   ints.Append(pmesh.GetNV());
+   ints.Append(pmesh.GetNE());
+   ints.Append(pmesh.GetNBE());
+   ints.Append(ngroups);
+   ints.Append(nodes ? 1 : 0);
+   ints.Append(nsv);
+   ints.Append(nse);
+   ints.Append(nst);
+   ints.Append(nsq);
+
+   Array<int> v;
+   for (int e = 0; e < pmesh.GetNE(); e++)
+   {
+      const Element *el = pmesh.GetElement(e);
+      el->GetVertices(v);
+      ints.Append(el->GetAttribute());
+      ints.Append(el->GetGeometryType());
+      ints.Append(v);
+   }
+   for (int b = 0; b < pmesh.GetNBE(); b++)
+   {
+      const Element *el = pmesh.GetBdrElement(b);
+      el->GetVertices(v);
+      ints.Append(el->GetAttribute());
+      ints.Append(el->GetGeometryType());
+      ints.Append(v);
+   }
+
+   const GroupTopology &gtopo = pmesh.gtopo;
+   for (int g = 1; g < ngroups; g++)
+   {
+      const int size = gtopo.GetGroupSize(g);
+      const int *lprocs = gtopo.GetGroup(g);
+      v.SetSize(size);
+      for (int i = 0; i < size; i++)
+      {
+         v[i] = gtopo.GetNeighborRank(lprocs[i]);
+      }
+      v.Sort();
+      ints.Append(size);
+      ints.Append(v);
+   }
+
+   // The shared edges and faces are stored with the vertex order of the
+   // group, which GroupEdge() and friends return relative to the local one.
+   Array<int> fv;
+   for (int g = 1; g < ngroups; g++)
+   {
+      ints.Append(pmesh.GroupNVertices(g));
+      for (int i = 0; i < pmesh.GroupNVertices(g); i++)
+      {
+         ints.Append(pmesh.GroupVertex(g, i));
+      }
+      ints.Append(pmesh.GroupNEdges(g));
+      for (int i = 0; i < pmesh.GroupNEdges(g); i++)
+      {
+         int edge, o;
+         pmesh.GroupEdge(g, i, edge, o);
+         pmesh.GetEdgeVertices(edge, fv);
+         const int lo = std::min(fv[0], fv[1]), hi = std::max(fv[0], fv[1]);
+         ints.Append(o > 0 ? lo : hi);
+         ints.Append(o > 0 ? hi : lo);
+      }
+      ints.Append(pmesh.GroupNTriangles(g));
+      for (int i = 0; i < pmesh.GroupNTriangles(g); i++)
+      {
+         int face, o, sv[3];
+         pmesh.GroupTriangle(g, i, face, o);
+         pmesh.GetFaceVertices(face, fv);
+         const int *orient = Geometry::Constants<Geometry::TRIANGLE>::Orient[o];
+         for (int j = 0; j < 3; j++) { sv[orient[j]] = fv[j]; }
+         ints.Append(sv, 3);
+      }
+      ints.Append(pmesh.GroupNQuadrilaterals(g));
+      for (int i = 0; i < pmesh.GroupNQuadrilaterals(g); i++)
+      {
+         int face, o, sv[4];
+         pmesh.GroupQuadrilateral(g, i, face, o);
+         pmesh.GetFaceVertices(face, fv);
+         const int *orient = Geometry::Constants<Geometry::SQUARE>::Orient[o];
+         for (int j = 0; j < 4; j++) { sv[orient[j]] = fv[j]; }
+         ints.Append(sv, 4);
+      }
+   }
+
+   const int nv = pmesh.GetNV();
+   reals.SetSize(nv * sdim + (nodes ? nodes->Size() : 0));
+   for (int i = 0; i < nv; i++)
+   {
+      const double *X = pmesh.GetVertex(i);
+      for (int d = 0; d < sdim; d++) { reals(i * sdim + d) = X[d]; }
+   }
+   if (nodes)
+   {
+      const FiniteElementSpace *fes = nodes->FESpace();
+      const std::string name = fes->FEColl()->Name();
+      ints.Append(fes->GetVDim());
+      ints.Append(fes->GetOrdering());
+      ints.Append(static_cast<int>(name.size()));
+      for (size_t c = 0; c < name.size(); c++) { ints.Append(name[c]); }
+      const double *N = nodes->HostRead();
+      std::copy(N, N + nodes->Size(), reals.GetData() + nv * sdim);
+   }
+}
+
+ParMesh *MakeParMesh(MPI_Comm comm, const Array<int> &ints,
+                     const Vector &reals)
+{
+   // The arrays are converted in memory into the input of the public
+   // ParMesh(comm, istream) constructor, as the pieces of
+   // MakeCartesianParMesh(). The nodes, the bulk of the real data of high
+   // order meshes, are copied into the node space of the new mesh instead.
+   const int *I = ints.GetData();
+   int p = 0;
+   const int dim = I[p++], sdim = I[p++], nv = I[p++], ne = I[p++];
+   const int nbe = I[p++], ngroups = I[p++], has_nodes = I[p++];
+   const int nsv = I[p++], nse = I[p++], nst = I[p++], nsq = I[p++];
+
+   std::stringstream piece;
+   piece.precision(17);
+   piece << "MFEM mesh v1.2\n\ndimension\n" << dim << "\n\nelements\n" << ne
+         << '\n';
+   for (int e = 0; e < ne + nbe; e++)
+   {
+      if (e == ne) { piece << "\nboundary\n" << nbe << '\n'; }
+      const int attr = I[p++], geom = I[p++];
+      piece << attr << ' ' << geom;
+      for (int v = 0; v < Geometry::NumVerts[geom]; v++)
+      {
+         piece << ' ' << I[p++];
+      }
+      piece << '\n';
+   }
+   if (nbe == 0) { piece << "\nboundary\n0\n"; }
+   piece << "\nvertices\n" << nv << '\n' << sdim << '\n';
+   for (int i = 0; i < nv; i++)
+   {
+      for (int d = 0; d < sdim; d++)
+      {
+         piece << (d > 0 ? " " : "") << reals(i * sdim + d);
+      }
+      piece << '\n';
+   }
+   piece << "\nmfem_serial_mesh_end\n";
+
+   int myid;
+   MPI_Comm_rank(comm, &myid);
+   piece << "\ncommunication_groups\nnumber_of_groups " << ngroups
+         << "\n\n# number of entities in each group, followed by group ids in"
+         << " group\n1 " << myid << '\n';
+   for (int g = 1; g < ngroups; g++)
+   {
+      const int size = I[p++];
+      piece << size;
+      for (int i = 0; i < size; i++) { piece << ' ' << I[p++]; }
+      piece << '\n';
+   }
+   piece << "\ntotal_shared_vertices " << nsv << '\n';
+   if (dim >= 2) { piece << "total_shared_edges " << nse << '\n'; }
+   if (dim >= 3) { piece << "total_shared_faces " << nst + nsq << '\n'; }
+   for (int g = 1; g < ngroups; g++)
+   {
+      int n = I[p++];
+      piece << "\n#group " << g << "\nshared_vertices " << n << '\n';
+      for (int i = 0; i < n; i++) { piece << I[p++] << '\n'; }
+      n = I[p++];
+      if (dim >= 2) { piece << "\nshared_edges " << n << '\n'; }
+      for (int i = 0; i < n; i++, p += 2)
+      {
+         piece << I[p] << ' ' << I[p+1] << '\n';
+      }
+      const int nt = I[p++];
+      const int *tria = I + p;
+      p += 3 * nt;
+      const int nq = I[p++];
+      const int *quad = I + p;
+      p += 4 * nq;
+      if (dim < 3) { continue; }
+      piece << "\nshared_faces " << nt + nq << '\n';
+      for (int i = 0; i < nt; i++, tria += 3)
+      {
+         piece << Geometry::TRIANGLE << ' ' << tria[0] << ' ' << tria[1]
+               << ' ' << tria[2] << '\n';
+      }
+      for (int i = 0; i < nq; i++, quad += 4)
+      {
+         piece << Geometry::SQUARE << ' ' << quad[0] << ' ' << quad[1]
+               << ' ' << quad[2] << ' ' << quad[3] << '\n';
+      }
+   }
+   piece << "\nmfem_mesh_end" << std::endl;
+   ParMesh *pmesh = new ParMesh(comm, piece);
+
+   if (has_nodes)
+   {
+      const int vdim = I[p++], ordering = I[p++], len = I[p++];
+      std::string name(I + p, I + p + len);
+      p += len;
+      FiniteElementCollection *fec = FiniteElementCollection::New(name.c_str());
+      ParFiniteElementSpace *pfes =
+         new ParFiniteElementSpace(pmesh, fec, vdim, ordering);
+      ParGridFunction *nodes = new ParGridFunction(pfes);
+      nodes->MakeOwner(fec);
+      MFEM_VERIFY(reals.Size() == nv * sdim + nodes->Size(),
+                  "The mesh nodes do not match their finite element space.");
+      const double *N = reals.GetData() + nv * sdim;
+      std::copy(N, N + nodes->Size(), nodes->HostWrite());
+      pmesh->NewNodes(*nodes, true);
+   }
+   MFEM_VERIFY(p == ints.Size(), "Corrupt mesh arrays.");
+   return pmesh;
+}
+
+Mesh *MakeLocalMesh(const Array<int> &ints, const Vector &reals)
+{
+   const int *I = ints.GetData();
+   int p = 0;
+   const int dim = I[p++], sdim = I[p++], nv = I[p++], ne = I[p++];
+   const int nbe = I[p++], ngroups = I[p++], has_nodes = I[p++];
+   p += 4;
+
+   Mesh *mesh = new Mesh(dim, nv, ne, nbe, sdim);
+   for (int i = 0; i < nv; i++) { mesh->AddVertex(reals.GetData() + i*sdim); }
+   for (int e = 0; e < ne + nbe; e++)
+   {
+      const int attr = I[p++];
+      Element *el = mesh->NewElement(I[p++]);
+      el->SetVertices(I + p);
+      el->SetAttribute(attr);
+      p += el->GetNVertices();
+      if (e < ne) { mesh->AddElement(el); }
+      else { mesh->AddBdrElement(el); }
+   }
+   // Skip the groups and the shared entities.
+   for (int g = 1; g < ngroups; g++) { p += 1 + I[p]; }
+   for (int g = 1; g < ngroups; g++)
+   {
+      p += 1 + I[p];
+      p += 1 + 2 * I[p];
+      p += 1 + 3 * I[p];
+      p += 1 + 4 * I[p];
+   }
+   mesh->FinalizeTopology();
+   mesh->Finalize();
+
+   if (has_nodes)
+   {
+      const int vdim = I[p++], ordering = I[p++], len = I[p++];
+      std::string name(I + p, I + p + len);
+      p += len;
+      FiniteElementCollection *fec = FiniteElementCollection::New(name.c_str());
+      FiniteElementSpace *fes =
+         new FiniteElementSpace(mesh, fec, vdim, ordering);
+      GridFunction *nodes = new GridFunction(fes);
+      nodes->MakeOwner(fec);
+      MFEM_VERIFY(reals.Size() == nv * sdim + nodes->Size(),
+                  "The mesh nodes do not match their finite element space.");
+      const double *N = reals.GetData() + nv * sdim;
+      std::copy(N, N + nodes->Size(), nodes->HostWrite());
+      mesh->NewNodes(*nodes, true);
+   }
+   MFEM_VERIFY(p == ints.Size(), "Corrupt mesh arrays.");
+   return mesh;
+}
+
+} // namespace hydrodynamics
+
+} // namespace mfem
+
+#endif // MFEM_USE_MPI
@@ -0,0 +1,82 @@
+// Copyright (c) 2017, Lawrence Livermore National Security, LLC. Produced at
+// the Lawrence Livermore National Laboratory. LLNL-CODE-734707. All Rights
+// reserved. See files LICENSE and NOTICE for details.
+//
+// This file is part of CEED, a collection of benchmarks, miniapps, software
+// libraries and APIs for efficient high-order finite element and spectral
+// element discretizations for exascale applications. For more information and
+// source code availability see http://github.com/ceed.
+//
+// The CEED research is supported by the Exascale Computing Project 17-SC-20-SC,
+// a collaborative effort of two U.S. Department of Energy organizations (Office
+// of Science and the National Nuclear Security Administration) responsible for
+// the planning and preparation of a capable exascale ecosystem, including
+// software, applications, hardware, advanced system engineering and early
+// testbed platforms, in support of the nation's exascale computing imperative.
+
+#ifndef MFEM_LAGHOS_MESH
+#define MFEM_LAGHOS_MESH
+
+#include "mfem.hpp"
+#include <iostream>
+
+#ifdef MFEM_USE_MPI
+
+namespace mfem
+{
+
+namespace hydrodynamics
+{
+
+// Writes the local part of rank myid of the Cartesian mesh of the box
+// [0,lxyz[0]] x ... with nxyz[d] zones in direction d, distributed over a
+// cxyz[0] x ... grid of ranks (rank = px + cx * (py + cy * pz)), in the format
+// of ParMesh::ParPrint(). The boundary attributes are d+1 on the boundaries
+// normal to direction d, as in the builtin meshes.
+void WriteCartesianMeshPiece(std::ostream &os, const int myid,
+                             const Array<int> &nxyz, const Array<int> &cxyz,
+                             const Vector &lxyz);
+
+// Constructs the ParMesh of the above Cartesian box directly from the local
+// parts, so the setup time and memory scale with the local number of zones.
+// The number of ranks of comm must be the product of the entries of cxyz.
+ParMesh *MakeCartesianParMesh(MPI_Comm comm, const Array<int> &nxyz,
+                              const Array<int> &cxyz, const Vector &lxyz);
+
+// Partitions the serial mesh, given on all ranks of comm, into one part per
+// rank along a Hilbert (or Morton) space-filling curve through the element
+// centers. Each part is a contiguous piece of the curve with the same number
+// of elements, for any number of ranks and any conforming mesh. The curve keys
+// of the elements are computed in parallel, each rank handling one slice of the
+// elements, and sorted with a parallel sample sort. The returned partitioning
+// array, which the ParMesh constructor needs in full on every rank, is still
+// of size NE, like the serial mesh itself. It is to be deleted by the caller,
+// as Mesh::CartesianPartitioning().
+int *SpaceFillingCurvePartitioning(MPI_Comm comm, Mesh &mesh,
+                                   const bool hilbert = true);
+
+// Stores the local part of the conforming ParMesh in plain arrays: the
+// topology, attributes, communication groups and shared entities in ints, the
+// vertex coordinates and the nodes, if any, in reals. With with_nodes = false,
+// the nodes are left out, e.g., when they are stored elsewhere. The group
+// accessors of ParMesh are not const, hence the non-const pmesh.
+void GetParMeshArrays(ParMesh &pmesh, Array<int> &ints, Vector &reals,
+                      const bool with_nodes = true);
+
+// Reconstructs the ParMesh from the arrays of GetParMeshArrays(), written with
+// the same number of ranks. The topology is passed to the ParMesh(comm,
+// istream) constructor in memory, and the nodes are copied directly.
+ParMesh *MakeParMesh(MPI_Comm comm, const Array<int> &ints,
+                     const Vector &reals);
+
+// Builds the local part described by the arrays of GetParMeshArrays() as a
+// serial Mesh, e.g., to merge the parts of several ranks on one of them.
+Mesh *MakeLocalMesh(const Array<int> &ints, const Vector &reals);
+
+} // namespace hydrodynamics
+
+} // namespace mfem
+
+#endif // MFEM_USE_MPI
+
+#endif // MFEM_LAGHOS_MESH
@@ -0,0 +1,335 @@
+// Copyright (c) 2017, Lawrence Livermore National Security, LLC. Produced at
+// the Lawrence Livermore National Laboratory. LLNL-CODE-734707. All Rights
+// reserved. See files LICENSE and NOTICE for details.
+//
+// This file is part of CEED, a collection of benchmarks, miniapps, software
+// libraries and APIs for efficient high-order finite element and spectral
+// element discretizations for exascale applications. For more information and
+// source code availability see http://github.com/ceed.
+//
+// The CEED research is supported by the Exascale Computing Project 17-SC-20-SC,
+// a collaborative effort of two U.S. Department of Energy organizations (Office
+// of Science and the National Nuclear Security Administration) responsible for
+// the planning and preparation of a capable exascale ecosystem, including
+// software, applications, hardware, advanced system engineering and early
+// testbed platforms, in support of the nation's exascale computing imperative.
+
+#include "laghos_perf.hpp"
+#include "laghos_assembly.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <vector>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#ifdef MFEM_USE_MPI
+
+namespace mfem
+{
+
+namespace hydrodynamics
+{
+
+static const int perf_nevents = 4;
+static const char *perf_event_names[perf_nevents] =
+{ "cycles", "instructions", "LLC misses", "FP events" };
+static const char *perf_kernel_names[PERF_NUM_KERNELS] =
+{ "ForceMult", "ForceMultTranspose", "QKernel", "Mass apply" };
+
+static bool perf_on = false, roofline_on = false;
+static int perf_fd[perf_nevents] = { -1, -1, -1, -1 };
+// Accumulated counts and number of calls of each kernel.
+static long long perf_counts[PERF_NUM_KERNELS][perf_nevents];
+static long long perf_calls[PERF_NUM_KERNELS];
+// Accumulated time, modeled operations and bytes of each kernel.
+static double roofline_data[PERF_NUM_KERNELS][3];
+static double roofline_bw = 0.0;
+
+static double PerfNow()
+{
+   const std::chrono::duration<double> t =
+      std::chrono::steady_clock::now().time_since_epoch();
+   return t.count();
+}
+
+// Operations of the dim sum factorized contractions from n^dim to m^dim
+// values, one direction at a time.
+static double Contract(const int dim, const int n, const int m)
+{
+   double flops = 0.0;
+   for (int k = 1; k <= dim; k++)
+   {
+      flops += 2.0 * pow(m, k) * pow(n, dim - k + 1);
+   }
+   return flops;
+}
+
+KernelCost ForceCost(const int dim, const int D1D, const int Q1D,
+                     const int L1D)
+{
+   const double D = pow(D1D, dim), Q = pow(Q1D, dim), L = pow(L1D, dim);
+   KernelCost c;
+   // Per component: dim scalings, dim transposed gradients and their sum.
+   c.flops = Contract(dim, L1D, Q1D) +
+             dim * (dim * Q + dim * Contract(dim, Q1D, D1D) + (dim - 1) * D);
+   // Energy in, stressJinvT in, velocity out.
+   c.bytes = 8.0 * (L + dim * dim * Q + dim * D);
+   return c;
+}
+
+KernelCost ForceTransposeCost(const int dim, const int D1D, const int Q1D,
+                              const int L1D)
+{
+   const double D = pow(D1D, dim), Q = pow(Q1D, dim), L = pow(L1D, dim);
+   KernelCost c;
+   // Per component: dim gradients, contracted with stressJinvT and summed.
+   c.flops = dim * (dim * Contract(dim, D1D, Q1D) + 2 * dim * Q) +
+             Contract(dim, Q1D, L1D);
+   // Velocity in, stressJinvT in, energy out.
+   c.bytes = 8.0 * (dim * D + dim * dim * Q + L);
+   return c;
+}
+
+KernelCost QKernelCost(const int dim, const int Q1D)
+{
+   const double Q = pow(Q1D, dim);
+   KernelCost c;
+   c.flops = Q * (6 * dim * dim * dim + 8 * dim * dim + (dim == 3 ? 180 : 60));
+   // Jacobian, velocity gradient, initial inverse Jacobian, rho0 detJ0 w and
+   // energy in, stressJinvT out.
+   c.bytes = 8.0 * Q * (4 * dim * dim + 2);
+   return c;
+}
+
+KernelCost MassCost(const int dim, const int D1D, const int Q1D)
+{
+   const double D = pow(D1D, dim), Q = pow(Q1D, dim);
+   KernelCost c;
+   c.flops = 2 * Contract(dim, D1D, Q1D) + Q;
+   // Gather (L-vector and indices in, E-vector out), the kernel (E-vector and
+   // point data in, E-vector out) and the scatter (the reverse of the gather).
+   c.bytes = 2 * (8.0 + 4.0 + 8.0) * D + 8.0 * (2 * D + Q);
+   return c;
+}
+
+#ifdef __linux__
+static int PerfOpen(const unsigned type, const unsigned long long config)
+{
+   perf_event_attr attr;
+   std::memset(&attr, 0, sizeof(attr));
+   attr.size = sizeof(attr);
+   attr.type = type;
+   attr.config = config;
+   attr.exclude_kernel = 1;
+   attr.exclude_hv = 1;
+   attr.inherit = 1;
+   attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED |
+                      PERF_FORMAT_TOTAL_TIME_RUNNING;
+   const long fd = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+   return static_cast<int>(fd);
+}
+#endif
+
+// Current count of event i, scaled up if the counter was multiplexed.
+static long long PerfRead(const int i)
+{
+#ifdef __linux__
+   unsigned long long v[3];
+   if (perf_fd[i] < 0 || read(perf_fd[i], v, sizeof(v)) != sizeof(v))
+   {
+      return 0;
+   }
+   if (v[2] == 0) { return 0; }
+   if (v[2] == v[1]) { return static_cast<long long>(v[0]); }
+   return static_cast<long long>(static_cast<double>(v[0]) * v[1] / v[2]);
+#else
+   return 0;
+#endif
+}
+
+bool PerfInit(const long long raw_fp_event)
+{
+   std::memset(perf_counts, 0, sizeof(perf_counts));
+   std::memset(perf_calls, 0, sizeof(perf_calls));
+#ifdef __linux__
+   perf_fd[0] = PerfOpen(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+   perf_fd[1] = PerfOpen(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+   perf_fd[2] = PerfOpen(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+   if (raw_fp_event != 0)
+   {
+      perf_fd[3] = PerfOpen(PERF_TYPE_RAW, raw_fp_event);
+   }
+   for (int i = 0; i < perf_nevents; i++)
+   {
+      if (perf_fd[i] >= 0) { perf_on = true; }
+   }
+#endif
+   return perf_on;
+}
+
+PerfScope::PerfScope(const PerfKernel kernel, const int ne,
+                     const KernelCost &cost)
+   : kernel(kernel), ne(ne), cost(cost), t0(0.0)
+{
+   if (roofline_on) { t0 = PerfNow(); }
+   if (!perf_on) { return; }
+   for (int i = 0; i < perf_nevents; i++) { c0[i] = PerfRead(i); }
+}
+
+PerfScope::~PerfScope()
+{
+   // The kernels may run asynchronously on a device.
+   if (perf_on || roofline_on) { MFEM_DEVICE_SYNC; }
+   if (perf_on)
+   {
+      for (int i = 0; i < perf_nevents; i++)
+      {
+         perf_counts[kernel][i] += PerfRead(i) - c0[i];
+      }
+      perf_calls[kernel]++;
+   }
+   if (roofline_on)
+   {
+      roofline_data[kernel][0] += PerfNow() - t0;
+      roofline_data[kernel][1] += ne * cost.flops;
+      roofline_data[kernel][2] += ne * cost.bytes;
+   }
+}
+
+void PerfPrint(MPI_Comm comm, const bool root)
+{
+   const int n = PERF_NUM_KERNELS * (perf_nevents + 1);
+   long long loc[n], glob[n];
+   int avail[perf_nevents], all_avail[perf_nevents];
+   for (int k = 0; k < PERF_NUM_KERNELS; k++)
+   {
+      for (int i = 0; i < perf_nevents; i++)
+      {
+         loc[k*(perf_nevents + 1) + i] = perf_counts[k][i];
+      }
+      loc[k*(perf_nevents + 1) + perf_nevents] = perf_calls[k];
+   }
+   for (int i = 0; i < perf_nevents; i++) { avail[i] = perf_fd[i] >= 0; }
+   MPI_Reduce(loc, glob, n, MPI_LONG_LONG, MPI_SUM, 0, comm);
+   MPI_Reduce(avail, all_avail, perf_nevents, MPI_INT, MPI_MIN, 0, comm);
+   if (!root) { return; }
+
+   using namespace std;
+   cout << endl << "Hardware counters (sum over the ranks):" << endl;
+   cout << left << setw(20) << "kernel" << right << setw(10) << "calls";
+   for (int i = 0; i < perf_nevents; i++)
+   {
+      cout << setw(15) << perf_event_names[i];
+   }
+   cout << setw(8) << "IPC" << setw(10) << "LLC MPKI" << endl;
+   cout << scientific << setprecision(4);
+   for (int k = 0; k < PERF_NUM_KERNELS; k++)
+   {
+      const long long *c = glob + k*(perf_nevents + 1);
+      if (c[perf_nevents] == 0) { continue; }
+      cout << left << setw(20) << perf_kernel_names[k] << right
+           << setw(10) << c[perf_nevents];
+      for (int i = 0; i < perf_nevents; i++)
+      {
+         if (all_avail[i]) { cout << setw(15) << static_cast<double>(c[i]); }
+         else { cout << setw(15) << "n/a"; }
+      }
+      cout << fixed << setprecision(2);
+      if (all_avail[0] && all_avail[1] && c[0] > 0)
+      {
+         cout << setw(8) << static_cast<double>(c[1]) / c[0];
+      }
+      else { cout << setw(8) << "n/a"; }
+      if (all_avail[1] && all_avail[2] && c[1] > 0)
+      {
+         cout << setw(10) << 1e3 * c[2] / c[1];
+      }
+      else { cout << setw(10) << "n/a"; }
+      cout << scientific << setprecision(4) << endl;
+   }
+   cout.unsetf(ios_base::floatfield);
+   cout << setprecision(6);
+}
+
+double RooflineInit(MPI_Comm comm)
+{
+   // Arrays of 16 MB, beyond the share of the last-level cache of a rank,
+   // first touched by the threads that use them.
+   const int n = 1 << 21, ntrials = 5;
+   std::vector<double> a(n), b(n), c(n);
+   LAGHOS_OMP(parallel for schedule(static))
+   for (int i = 0; i < n; i++) { a[i] = 0.0; b[i] = 1.0; c[i] = 2.0; }
+   double *A = a.data();
+   const double *B = b.data(), *C = c.data(), s = 3.0;
+   double best = 1e100;
+   for (int t = 0; t < ntrials; t++)
+   {
+      MPI_Barrier(comm);
+      const double t0 = PerfNow();
+      LAGHOS_OMP(parallel for schedule(static))
+      for (int i = 0; i < n; i++) { A[i] = B[i] + s * C[i]; }
+      best = std::min(best, PerfNow() - t0);
+   }
+   MFEM_VERIFY(A[n - 1] == 7.0, "Wrong result of the bandwidth probe.");
+   roofline_bw = 1e-9 * 3 * sizeof(double) * n / best;
+   std::memset(roofline_data, 0, sizeof(roofline_data));
+   roofline_on = true;
+   return roofline_bw;
+}
+
+void RooflinePrint(MPI_Comm comm, const bool root)
+{
+   // Per rank: the time of each kernel (max over the ranks), and the rates
+   // and bandwidth (sums over the ranks).
+   const int nk = PERF_NUM_KERNELS;
+   double t_loc[nk], t_max[nk], loc[2*nk + 1], glob[2*nk + 1];
+   double flops[nk], bytes[nk];
+   for (int k = 0; k < nk; k++)
+   {
+      const double t = roofline_data[k][0];
+      t_loc[k] = t;
+      loc[2*k] = (t > 0.0) ? roofline_data[k][1] / t : 0.0;
+      loc[2*k + 1] = (t > 0.0) ? roofline_data[k][2] / t : 0.0;
+      flops[k] = roofline_data[k][1];
+      bytes[k] = roofline_data[k][2];
+   }
+   loc[2*nk] = roofline_bw;
+   MPI_Reduce(t_loc, t_max, nk, MPI_DOUBLE, MPI_MAX, 0, comm);
+   MPI_Reduce(loc, glob, 2*nk + 1, MPI_DOUBLE, MPI_SUM, 0, comm);
+   MPI_Allreduce(MPI_IN_PLACE, flops, nk, MPI_DOUBLE, MPI_SUM, comm);
+   MPI_Allreduce(MPI_IN_PLACE, bytes, nk, MPI_DOUBLE, MPI_SUM, comm);
+   if (!root) { return; }
+
+   using namespace std;
+   const double bw = glob[2*nk];
+   cout << endl << "Roofline (sums over the ranks), STREAM triad bandwidth: "
+        << fixed << setprecision(1) << bw << " GB/s" << endl;
+   cout << left << setw(20) << "kernel" << right << setw(10) << "time"
+        << setw(10) << "GFLOP/s" << setw(10) << "GB/s" << setw(10) << "FLOP/B"
+        << setw(10) << "% roof" << endl;
+   for (int k = 0; k < nk; k++)
+   {
+      if (t_max[k] == 0.0 || bytes[k] == 0.0) { continue; }
+      const double gflops = 1e-9 * glob[2*k], gbs = 1e-9 * glob[2*k + 1];
+      const double ai = flops[k] / bytes[k];
+      cout << left << setw(20) << perf_kernel_names[k] << right
+           << setprecision(3) << setw(10) << t_max[k]
+           << setprecision(2) << setw(10) << gflops << setw(10) << gbs
+           << setw(10) << ai << setprecision(1)
+           << setw(10) << 100.0 * gflops / (ai * bw) << endl;
+   }
+   cout.unsetf(ios_base::floatfield);
+   cout << setprecision(6);
+}
+
+} // namespace hydrodynamics
+
+} // namespace mfem
+
+#endif // MFEM_USE_MPI
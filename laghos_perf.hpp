@@ -0,0 +1,109 @@
+// Copyright (c) 2017, Lawrence Livermore National Security, LLC. Produced at
+// the Lawrence Livermore National Laboratory. LLNL-CODE-734707. All Rights
+// reserved. See files LICENSE and NOTICE for details.
+//
+// This file is part of CEED, a collection of benchmarks, miniapps, software
+// libraries and APIs for efficient high-order finite element and spectral
+// element discretizations for exascale applications. For more information and
+// source code availability see http://github.com/ceed.
+//
+// The CEED research is supported by the Exascale Computing Project 17-SC-20-SC,
+// a collaborative effort of two U.S. Department of Energy organizations (Office
+// of Science and the National Nuclear Security Administration) responsible for
+// the planning and preparation of a capable exascale ecosystem, including
+// software, applications, hardware, advanced system engineering and early
+// testbed platforms, in support of the nation's exascale computing imperative.
+
+#ifndef MFEM_LAGHOS_PERF
+#define MFEM_LAGHOS_PERF
+
+#include "mfem.hpp"
+
+#ifdef MFEM_USE_MPI
+
+namespace mfem
+{
+
+namespace hydrodynamics
+{
+
+// Major kernels measured with the hardware performance counters and the
+// roofline model.
+enum PerfKernel
+{
+   PERF_FORCE, PERF_FORCE_TRANSPOSE, PERF_QKERNEL, PERF_MASS, PERF_NUM_KERNELS
+};
+
+// Floating-point operations (a fused multiply-add counts as 2) and bytes of
+// main memory traffic of one zone of a kernel. The traffic is the compulsory
+// one: each input is read and each output is written once, and the 1D bases
+// stay in cache. D1D, Q1D and L1D are the numbers of 1D dofs of the kinematic
+// space, of 1D quadrature points and of 1D dofs of the thermodynamic space.
+struct KernelCost
+{
+   double flops, bytes;
+};
+// ForceMult2D/3D: sum factorized interpolation of the energy to the points,
+// then for each velocity component, scaling by stressJinvT and the
+// transposed gradient to the dofs.
+KernelCost ForceCost(const int dim, const int D1D, const int Q1D,
+                     const int L1D);
+// ForceMultTranspose2D/3D: the reverse sequence.
+KernelCost ForceTransposeCost(const int dim, const int D1D, const int Q1D,
+                              const int L1D);
+// QKernel, with the artificial viscosity: about 6 dim^3 + 8 dim^2 operations
+// in the small matrix products and a fixed cost of the eigensolver and of the
+// equation of state at each point, counting the square roots as 1.
+KernelCost QKernelCost(const int dim, const int Q1D);
+// Mass action B^T D B of a scalar space, including the gather and scatter of
+// the element restriction (with 32-bit indices).
+KernelCost MassCost(const int dim, const int D1D, const int Q1D);
+
+// Opens the Linux perf_event_open counters of the calling process: cycles,
+// instructions, last-level cache misses and, if raw_fp_event is not 0, the
+// raw hardware event with that code, e.g. 0x15c7 (FP_ARITH_INST_RETIRED,
+// scalar and packed double instructions) on recent Intel CPUs, as there is no
+// portable FLOP event. Counters that the kernel or the CPU does not provide
+// are reported as unavailable. Only the threads created after the call are
+// counted, so it must precede the first parallel region. Returns false if no
+// counter is available, e.g., when /proc/sys/kernel/perf_event_paranoid
+// forbids them, or not on Linux.
+bool PerfInit(const long long raw_fp_event);
+// Prints the counts per kernel summed over the ranks, with the instructions
+// per cycle and the cache misses per kilo-instruction. Collective on comm.
+void PerfPrint(MPI_Comm comm, const bool root);
+
+// Measures the memory bandwidth of each rank with the STREAM triad
+// a = b + s c, the ranks running simultaneously, and starts the timing of the
+// kernels. Returns the bandwidth of this rank in GB/s. Collective on comm.
+double RooflineInit(MPI_Comm comm);
+// Prints, for each kernel, its time, achieved GFLOP/s and GB/s, arithmetic
+// intensity (FLOP/byte) and the fraction of the memory roof, intensity x
+// bandwidth, that it reaches. The rates are summed over the ranks, as they run
+// simultaneously. Collective on comm.
+void RooflinePrint(MPI_Comm comm, const bool root);
+
+// Accumulates the counts and the time during the lifetime of the object to
+// the kernel, applied to ne zones of the given cost. Scopes do not nest. When
+// the counters are enabled, each counter is read at both ends of the scope,
+// after waiting for the device to finish the kernels of the scope.
+class PerfScope
+{
+private:
+   const int kernel;
+   const int ne;
+   const KernelCost cost;
+   long long c0[4];
+   double t0;
+public:
+   PerfScope(const PerfKernel kernel, const int ne, const KernelCost &cost);
+   ~PerfScope();
+};
+
+} // namespace hydrodynamics
+
+} // namespace mfem
+
+#endif // MFEM_USE_MPI
+
+#endif // MFEM_LAGHOS_PERF
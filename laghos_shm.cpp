@@ -0,0 +1,144 @@
+// Copyright (c) 2017, Lawrence Livermore National Security, LLC. Produced at
+// the Lawrence Livermore National Laboratory. LLNL-CODE-734707. All Rights
+// reserved. See files LICENSE and NOTICE for details.
+//
+// This file is part of CEED, a collection of benchmarks, miniapps, software
+// libraries and APIs for efficient high-order finite element and spectral
+// element discretizations for exascale applications. For more information and
+// source code availability see http://github.com/ceed.
+//
+// The CEED research is supported by the Exascale Computing Project 17-SC-20-SC,
+// a collaborative effort of two U.S. Department of Energy organizations (Office
+// of Science and the National Nuclear Security Administration) responsible for
+// the planning and preparation of a capable exascale ecosystem, including
+// software, applications, hardware, advanced system engineering and early
+// testbed platforms, in support of the nation's exascale computing imperative.
+
+#include "laghos_shm.hpp"
+#include "laghos_io.hpp"
+#include <cstring>
+#include <new>
+#include <sstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#ifdef MFEM_USE_MPI
+
+namespace mfem
+{
+
+namespace hydrodynamics
+{
+
+static const char shm_magic[8] = { 'L','A','G','H','O','S','S','H' };
+
+// Offsets of the sections are rounded up to cache lines.
+static long long AlignUp(const long long n) { return (n + 63) / 64 * 64; }
+
+SharedStateExporter::SharedStateExporter(const char *shm_name,
+                                         const ParMesh &pmesh,
+                                         const ParGridFunction &x,
+                                         const ParGridFunction &v,
+                                         const ParGridFunction &e,
+                                         const ParGridFunction &rho,
+                                         const int nslots)
+   : name(RankFileName(std::string("/") + shm_name, pmesh.GetMyRank())),
+     bytes(0), base(NULL), header(NULL), next_slot(0)
+{
+   static_assert(ATOMIC_LLONG_LOCK_FREE == 2,
+                 "The seqlock requires lock-free 64-bit atomics.");
+   MFEM_VERIFY(nslots > 0, "Invalid number of slots " << nslots);
+   MFEM_VERIFY(std::strchr(shm_name, '/') == NULL,
+               "The shared-memory name cannot contain '/': " << shm_name);
+
+   std::ostringstream mesh_os;
+   mesh_os.precision(16);
+   pmesh.ParPrint(mesh_os);
+   const std::string mesh = mesh_os.str();
+
+   const long long nvalues = x.Size() + v.Size() + e.Size() + rho.Size();
+   const long long mesh_offset = AlignUp(sizeof(SharedStateHeader));
+   const long long slot_offset = AlignUp(mesh_offset + mesh.size());
+   const long long slot_data_offset = AlignUp(sizeof(SharedStateSlot));
+   const long long slot_bytes = AlignUp(slot_data_offset +
+                                        nvalues * sizeof(double));
+   bytes = slot_offset + nslots * slot_bytes;
+
+   shm_unlink(name.c_str());
+   const int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR,
+                           0600);
+   MFEM_VERIFY(fd >= 0, "Cannot create shared-memory segment " << name);
+   MFEM_VERIFY(ftruncate(fd, bytes) == 0,
+               "Cannot resize shared-memory segment " << name);
+   void *ptr = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+   close(fd);
+   MFEM_VERIFY(ptr != MAP_FAILED,
+               "Cannot map shared-memory segment " << name);
+   base = static_cast<char *>(ptr);
+
+   header = new (base) SharedStateHeader;
+   std::memcpy(header->magic, shm_magic, 8);
+   header->version = shm_version;
+   header->rank = pmesh.GetMyRank();
+   header->nranks = pmesh.GetNRanks();
+   header->dim = pmesh.Dimension();
+   header->nslots = nslots;
+   header->x_size = x.Size();
+   header->v_size = v.Size();
+   header->e_size = e.Size();
+   header->rho_size = rho.Size();
+   std::strncpy(header->h1_fec, x.FESpace()->FEColl()->Name(), 63);
+   std::strncpy(header->l2_fec, e.FESpace()->FEColl()->Name(), 63);
+   header->h1_fec[63] = header->l2_fec[63] = '\0';
+   header->mesh_offset = mesh_offset;
+   header->mesh_size = mesh.size();
+   header->slot_offset = slot_offset;
+   header->slot_bytes = slot_bytes;
+   header->slot_data_offset = slot_data_offset;
+   std::memcpy(base + mesh_offset, mesh.data(), mesh.size());
+   for (int s = 0; s < nslots; s++)
+   {
+      SharedStateSlot *slot = new (Slot(s)) SharedStateSlot;
+      slot->seq.store(0, std::memory_order_relaxed);
+      slot->cycle = -1;
+      slot->time = 0.0;
+   }
+   header->latest.store(-1, std::memory_order_release);
+}
+
+SharedStateExporter::~SharedStateExporter()
+{
+   munmap(base, bytes);
+   shm_unlink(name.c_str());
+}
+
+void SharedStateExporter::Update(const int cycle, const double time,
+                                 const Vector &S, const ParGridFunction &rho)
+{
+   const long long s_size = header->x_size + header->v_size + header->e_size;
+   MFEM_VERIFY(S.Size() == s_size && rho.Size() == header->rho_size,
+               "The sizes of the exported state changed.");
+   const int s = next_slot;
+   next_slot = (next_slot + 1) % header->nslots;
+
+   SharedStateSlot *slot = Slot(s);
+   double *data = reinterpret_cast<double *>(reinterpret_cast<char *>(slot) +
+                                             header->slot_data_offset);
+   const unsigned long long seq = slot->seq.load(std::memory_order_relaxed);
+   slot->seq.store(seq + 1, std::memory_order_relaxed);
+   std::atomic_thread_fence(std::memory_order_release);
+   slot->cycle = cycle;
+   slot->time = time;
+   std::memcpy(data, S.HostRead(), s_size * sizeof(double));
+   std::memcpy(data + s_size, rho.HostRead(),
+               header->rho_size * sizeof(double));
+   slot->seq.store(seq + 2, std::memory_order_release);
+   header->latest.store(s, std::memory_order_release);
+}
+
+} // namespace hydrodynamics
+
+} // namespace mfem
+
+#endif // MFEM_USE_MPI
@@ -0,0 +1,110 @@
+// Copyright (c) 2017, Lawrence Livermore National Security, LLC. Produced at
+// the Lawrence Livermore National Laboratory. LLNL-CODE-734707. All Rights
+// reserved. See files LICENSE and NOTICE for details.
+//
+// This file is part of CEED, a collection of benchmarks, miniapps, software
+// libraries and APIs for efficient high-order finite element and spectral
+// element discretizations for exascale applications. For more information and
+// source code availability see http://github.com/ceed.
+//
+// The CEED research is supported by the Exascale Computing Project 17-SC-20-SC,
+// a collaborative effort of two U.S. Department of Energy organizations (Office
+// of Science and the National Nuclear Security Administration) responsible for
+// the planning and preparation of a capable exascale ecosystem, including
+// software, applications, hardware, advanced system engineering and early
+// testbed platforms, in support of the nation's exascale computing imperative.
+
+#ifndef MFEM_LAGHOS_SHM
+#define MFEM_LAGHOS_SHM
+
+#include "mfem.hpp"
+#include <atomic>
+#include <string>
+
+#ifdef MFEM_USE_MPI
+
+namespace mfem
+{
+
+namespace hydrodynamics
+{
+
+// Export of the state of each rank into a POSIX shared-memory segment, named
+// /<name>.<rank>, for analysis processes on the same node. The segment starts
+// with a SharedStateHeader, followed by the ParMesh::ParPrint() output of the
+// local mesh, which is written once, and by nslots data slots. Each slot holds
+// a SharedStateSlot, followed (at slot_data_offset) by the values of the state
+// vector S = (x, v, e), where x are the mesh node positions, and by the values
+// of the density. The slots are written in turn, so a consumer can read the
+// most recent one while the next one is being written.
+//
+// Each slot is protected by a seqlock. A consumer reads slot s as follows:
+//    do
+//    {
+//       seq = slot->seq.load(std::memory_order_acquire);
+//       ... read the data of the slot (seq is odd during an update) ...
+//       std::atomic_thread_fence(std::memory_order_acquire);
+//    }
+//    while ((seq & 1) || slot->seq.load(std::memory_order_relaxed) != seq);
+// The layout uses only fixed-size types, so consumers only need this header.
+struct SharedStateHeader
+{
+   char magic[8];
+   int version, rank, nranks, dim;
+   int nslots;
+   // Sizes of the x, v and e blocks of S and of the density.
+   long long x_size, v_size, e_size, rho_size;
+   // Names of the finite element collections of x, v (H1) and e, rho (L2).
+   char h1_fec[64], l2_fec[64];
+   // Byte offsets from the start of the segment and sizes.
+   long long mesh_offset, mesh_size;
+   long long slot_offset, slot_bytes, slot_data_offset;
+   // Index of the most recently completed slot, -1 before the first update.
+   std::atomic<long long> latest;
+};
+
+struct SharedStateSlot
+{
+   std::atomic<unsigned long long> seq;
+   int cycle;
+   double time;
+};
+
+static const int shm_version = 1;
+
+class SharedStateExporter
+{
+private:
+   std::string name;
+   size_t bytes;
+   char *base;
+   SharedStateHeader *header;
+   int next_slot;
+
+   SharedStateSlot *Slot(const int s) const
+   {
+      return reinterpret_cast<SharedStateSlot *>(
+                base + header->slot_offset + s * header->slot_bytes);
+   }
+
+public:
+   // Creates the segment of this rank, sized for the given S and density.
+   SharedStateExporter(const char *shm_name, const ParMesh &pmesh,
+                       const ParGridFunction &x, const ParGridFunction &v,
+                       const ParGridFunction &e, const ParGridFunction &rho,
+                       const int nslots = 2);
+   // Unmaps and unlinks the segment; mapped consumers keep their view.
+   ~SharedStateExporter();
+
+   // Copies S and the density into the next slot.
+   void Update(const int cycle, const double time, const Vector &S,
+               const ParGridFunction &rho);
+};
+
+} // namespace hydrodynamics
+
+} // namespace mfem
+
+#endif // MFEM_USE_MPI
+
+#endif // MFEM_LAGHOS_SHM
@@ -16,6 +16,9 @@
 
 #include "general/forall.hpp"
 #include "laghos_solver.hpp"
+#include "laghos_memory.hpp"
+#include "laghos_perf.hpp"
+#include "laghos_trace.hpp"
 #include "linalg/kernels.hpp"
 #include <unordered_map>
 
@@ -88,6 +91,16 @@ static void Rho0DetJ0Vol(const int dim, const int NE,
                          QuadratureData &qdata,
                          double &volume);
 
+// Reduction used for the bundled time step estimate message: the first entry
+// is the dt estimate (MPI_MIN), all other entries are diagnostics (MPI_SUM).
+static void DtMinDiagSum(void *in, void *inout, int *len, MPI_Datatype *)
+{
+   const double *a = static_cast<const double*>(in);
+   double *b = static_cast<double*>(inout);
+   if (*len > 0) { b[0] = fmin(a[0], b[0]); }
+   for (int i = 1; i < *len; i++) { b[i] += a[i]; }
+}
+
 LagrangianHydroOperator::LagrangianHydroOperator(const int size,
                                                  ParFiniteElementSpace &h1,
                                                  ParFiniteElementSpace &l2,
@@ -109,10 +122,10 @@ LagrangianHydroOperator::LagrangianHydroOperator(const int size,
    pmesh(H1.GetParMesh()),
    H1Vsize(H1.GetVSize()),
    H1TVSize(H1.TrueVSize()),
-   H1GTVSize(H1.GlobalTrueVSize()),
+   H1GTVSize(GlobalCount(H1.GetComm(), H1.TrueVSize())),
    L2Vsize(L2.GetVSize()),
    L2TVSize(L2.TrueVSize()),
-   L2GTVSize(L2.GlobalTrueVSize()),
+   L2GTVSize(GlobalCount(L2.GetComm(), L2.TrueVSize())),
    block_offsets(4),
    x_gf(&H1),
    ess_tdofs(ess_tdofs),
@@ -138,6 +151,7 @@ LagrangianHydroOperator::LagrangianHydroOperator(const int size,
    Force(&L2, &H1),
    ForcePA(nullptr), VMassPA(nullptr), EMassPA(nullptr),
    VMassPA_Jprec(nullptr),
+   H1c_P(nullptr), H1_P(nullptr),
    CG_VMass(H1.GetParMesh()->GetComm()),
    CG_EMass(L2.GetParMesh()->GetComm()),
    timer(p_assembly ? L2TVSize : 1),
@@ -148,8 +162,11 @@ LagrangianHydroOperator::LagrangianHydroOperator(const int size,
    rhs(H1Vsize),
    e_rhs(L2Vsize),
    rhs_c_gf(&H1c),
-   dvc_gf(&H1c)
+   dvc_gf(&H1c),
+   dt_red_size(0),
+   dt_red_req(MPI_REQUEST_NULL)
 {
+   MPI_Op_create(&DtMinDiagSum, 1, &dt_red_op);
    block_offsets[0] = 0;
    block_offsets[1] = block_offsets[0] + H1Vsize;
    block_offsets[2] = block_offsets[1] + H1Vsize;
@@ -190,15 +207,20 @@ LagrangianHydroOperator::LagrangianHydroOperator(const int size,
       // Standard local assembly and inversion for energy mass matrices.
       // 'Me' is used in the computation of the internal energy
       // which is used twice: once at the start and once at the end of the run.
-      MassIntegrator mi(rho0_coeff, &ir);
-      for (int e = 0; e < NE; e++)
+      LAGHOS_OMP_FE(parallel)
       {
-         DenseMatrixInverse inv(&Me(e));
-         const FiniteElement &fe = *L2.GetFE(e);
-         ElementTransformation &Tr = *L2.GetElementTransformation(e);
-         mi.AssembleElementMatrix(fe, Tr, Me(e));
-         inv.Factor();
-         inv.GetInverseMatrix(Me_inv(e));
+         MassIntegrator mi(rho0_coeff, &ir);
+         IsoparametricTransformation Tr;
+         LAGHOS_OMP_FE(for schedule(static))
+         for (int e = 0; e < NE; e++)
+         {
+            DenseMatrixInverse inv(&Me(e));
+            const FiniteElement &fe = *L2.GetFE(e);
+            pmesh->GetElementTransformation(e, &Tr);
+            mi.AssembleElementMatrix(fe, Tr, Me(e));
+            inv.Factor();
+            inv.GetInverseMatrix(Me_inv(e));
+         }
       }
       // Standard assembly for the velocity mass matrix.
       VectorMassIntegrator *vmi = new VectorMassIntegrator(rho0_coeff, &ir);
@@ -215,25 +237,43 @@ LagrangianHydroOperator::LagrangianHydroOperator(const int size,
    {
       Rho0DetJ0Vol(dim, NE, ir, pmesh, L2, rho0_gf, qdata, vol);
    }
-   else
+   else if (NE > 0)
    {
       const int NQ = ir.GetNPoints();
-      Vector rho_vals(NQ);
-      for (int e = 0; e < NE; e++)
+      // Same rule as in Mesh::GetElementVolume(), fetched before the threaded
+      // loop because IntRules.Get() may create it. It needs a local zone, so
+      // ranks without zones skip the whole block.
+      const IntegrationRule &vol_ir =
+         IntRules.Get(pmesh->GetElementBaseGeometry(0),
+                      H1.GetElementTransformation(0)->OrderJ());
+      LAGHOS_OMP_FE(parallel reduction(+:vol))
       {
-         rho0_gf.GetValues(e, ir, rho_vals);
-         ElementTransformation &Tr = *H1.GetElementTransformation(e);
-         for (int q = 0; q < NQ; q++)
+         Vector rho_vals(NQ);
+         IsoparametricTransformation Tr;
+         LAGHOS_OMP_FE(for schedule(static))
+         for (int e = 0; e < NE; e++)
          {
-            const IntegrationPoint &ip = ir.IntPoint(q);
-            Tr.SetIntPoint(&ip);
-            DenseMatrixInverse Jinv(Tr.Jacobian());
-            Jinv.GetInverseMatrix(qdata.Jac0inv(e*NQ + q));
-            const double rho0DetJ0 = Tr.Weight() * rho_vals(q);
-            qdata.rho0DetJ0w(e*NQ + q) = rho0DetJ0 * ir.IntPoint(q).weight;
+            pmesh->GetElementTransformation(e, &Tr);
+            rho0_gf.GetValues(Tr, ir, rho_vals);
+            for (int q = 0; q < NQ; q++)
+            {
+               const IntegrationPoint &ip = ir.IntPoint(q);
+               Tr.SetIntPoint(&ip);
+               DenseMatrixInverse Jinv(Tr.Jacobian());
+               Jinv.GetInverseMatrix(qdata.Jac0inv(e*NQ + q));
+               const double rho0DetJ0 = Tr.Weight() * rho_vals(q);
+               qdata.rho0DetJ0w(e*NQ + q) = rho0DetJ0 * ir.IntPoint(q).weight;
+            }
+            double vol_e = 0.0;
+            for (int q = 0; q < vol_ir.GetNPoints(); q++)
+            {
+               const IntegrationPoint &ip = vol_ir.IntPoint(q);
+               Tr.SetIntPoint(&ip);
+               vol_e += ip.weight * Tr.Weight();
+            }
+            vol += vol_e;
          }
       }
-      for (int e = 0; e < NE; e++) { vol += pmesh->GetElementVolume(e); }
    }
    MPI_Allreduce(&vol, &Volume, 1, MPI_DOUBLE, MPI_SUM, pmesh->GetComm());
    MPI_Allreduce(&ne, &Ne, 1, MPI_INT, MPI_SUM, pmesh->GetComm());
@@ -282,6 +322,11 @@ LagrangianHydroOperator::LagrangianHydroOperator(const int size,
 
 LagrangianHydroOperator::~LagrangianHydroOperator()
 {
+   if (dt_red_req != MPI_REQUEST_NULL)
+   {
+      MPI_Wait(&dt_red_req, MPI_STATUS_IGNORE);
+   }
+   MPI_Op_free(&dt_red_op);
    delete qupdate;
    if (p_assembly)
    {
@@ -290,6 +335,36 @@ LagrangianHydroOperator::~LagrangianHydroOperator()
       delete VMassPA_Jprec;
       delete ForcePA;
    }
+   delete H1c_P;
+   delete H1_P;
+}
+
+void LagrangianHydroOperator::PlaceZoneData(ZoneMemory &mem)
+{
+   const int NQ = ir.GetNPoints();
+   MFEM_VERIFY(qdata.rho0DetJ0w.Size() == NE * NQ, "Invalid quadrature data.");
+   mem.Place(qdata.Jac0inv, NE);
+   mem.Place(qdata.stressJinvT, NE, dim * dim);
+   mem.Place(qdata.rho0DetJ0w, NE);
+   if (p_assembly)
+   {
+      ForcePA->PlaceZoneData(mem);
+      qupdate->PlaceZoneData(mem);
+   }
+}
+
+void LagrangianHydroOperator::UseNodeLocalExchange()
+{
+   MFEM_VERIFY(p_assembly && !Device::Allows(Backend::DEVICE_MASK),
+               "The node-local exchange requires partial assembly on the CPU.");
+   if (H1c_P) { return; }
+   H1c_P = new NodeLocalProlongation(H1c);
+   VMassPA->SetProlongation(H1c_P);
+   if (ForcePA->ReducesSharedDofs())
+   {
+      H1_P = new NodeLocalProlongation(H1);
+      ForcePA->SetNodeLocalExchange(H1_P);
+   }
 }
 
 void LagrangianHydroOperator::Mult(const Vector &S, Vector &dS_dt) const
@@ -297,6 +372,8 @@ void LagrangianHydroOperator::Mult(const Vector &S, Vector &dS_dt) const
    // Make sure that the mesh positions correspond to the ones in S. This is
    // needed only because some mfem time integrators don't update the solution
    // vector at every intermediate stage (hence they don't change the mesh).
+   LAGHOS_TRACE("stage");
+   timer.sw_stage.Start();
    UpdateMesh(S);
    // The monolithic BlockVector stores the unknown fields as follows:
    // (Position, Velocity, Specific Internal Energy).
@@ -311,11 +388,13 @@ void LagrangianHydroOperator::Mult(const Vector &S, Vector &dS_dt) const
    SolveVelocity(S, dS_dt);
    SolveEnergy(S, v, dS_dt);
    qdata_is_current = false;
+   timer.sw_stage.Stop();
 }
 
 void LagrangianHydroOperator::SolveVelocity(const Vector &S,
                                             Vector &dS_dt) const
 {
+   LAGHOS_TRACE("velocity");
    UpdateQuadratureData(S);
    AssembleForceMatrix();
    // The monolithic BlockVector stores the unknown fields as follows:
@@ -335,21 +414,36 @@ void LagrangianHydroOperator::SolveVelocity(const Vector &S,
 
    if (p_assembly)
    {
+      // When available, the shared dofs of rhs are summed on their owners
+      // during the force action, overlapped with the interior zones. The
+      // remaining wait for the exchange is timed as halo time.
+      const bool reduced = ForcePA->ReducesSharedDofs();
       timer.sw_force.Start();
-      ForcePA->Mult(one, rhs);
+      if (reduced) { ForcePA->MultReduced(one, rhs); }
+      else { ForcePA->Mult(one, rhs); }
       timer.sw_force.Stop();
+      if (reduced)
+      {
+         timer.sw_halo.Start();
+         ForcePA->MultReducedEnd(rhs);
+         timer.sw_halo.Stop();
+      }
       rhs.Neg();
 
       // Partial assembly solve for each velocity component
       const int size = H1c.GetVSize();
       const Operator *Pconf = H1c.GetProlongationMatrix();
+      if (H1c_P) { Pconf = H1c_P; }
       for (int c = 0; c < dim; c++)
       {
          dvc_gf.MakeRef(&H1c, dS_dt, H1Vsize + c*size);
          rhs_c_gf.MakeRef(&H1c, rhs, c*size);
 
-         if (Pconf) { Pconf->MultTranspose(rhs_c_gf, B); }
+         timer.sw_halo.Start();
+         if (reduced) { H1c.GetRestrictionMatrix()->Mult(rhs_c_gf, B); }
+         else if (Pconf) { Pconf->MultTranspose(rhs_c_gf, B); }
          else { B = rhs_c_gf; }
+         timer.sw_halo.Stop();
 
          if (source_type == 2)
          {
@@ -366,11 +460,16 @@ void LagrangianHydroOperator::SolveVelocity(const Vector &S,
          VMassPA->SetEssentialTrueDofs(c_tdofs[c]);
          VMassPA->EliminateRHS(B);
          timer.sw_cgH1.Start();
-         CG_VMass.Mult(B, X);
+         {
+            LAGHOS_TRACE("cg_h1");
+            CG_VMass.Mult(B, X);
+         }
          timer.sw_cgH1.Stop();
          timer.H1iter += CG_VMass.GetNumIterations();
+         timer.sw_halo.Start();
          if (Pconf) { Pconf->Mult(X, dvc_gf); }
          else { dvc_gf = X; }
+         timer.sw_halo.Stop();
          // We need to sync the subvector 'dvc_gf' with its base vector
          // because it may have been moved to a different memory space.
          dvc_gf.GetMemory().SyncAlias(dS_dt.GetMemory(), dvc_gf.Size());
@@ -403,7 +502,10 @@ void LagrangianHydroOperator::SolveVelocity(const Vector &S,
       cg.SetMaxIter(cg_max_iter);
       cg.SetPrintLevel(-1);
       timer.sw_cgH1.Start();
-      cg.Mult(B, X);
+      {
+         LAGHOS_TRACE("cg_h1");
+         cg.Mult(B, X);
+      }
       timer.sw_cgH1.Stop();
       timer.H1iter += cg.GetNumIterations();
       Mv.RecoverFEMSolution(X, rhs, dv);
@@ -413,6 +515,7 @@ void LagrangianHydroOperator::SolveVelocity(const Vector &S,
 void LagrangianHydroOperator::SolveEnergy(const Vector &S, const Vector &v,
                                           Vector &dS_dt) const
 {
+   LAGHOS_TRACE("energy");
    UpdateQuadratureData(S);
    AssembleForceMatrix();
 
@@ -433,7 +536,6 @@ void LagrangianHydroOperator::SolveEnergy(const Vector &S, const Vector &v,
       e_source->Assemble();
    }
 
-   Array<int> l2dofs;
    if (p_assembly)
    {
       timer.sw_force.Start();
@@ -441,9 +543,12 @@ void LagrangianHydroOperator::SolveEnergy(const Vector &S, const Vector &v,
       timer.sw_force.Stop();
       if (e_source) { e_rhs += *e_source; }
       timer.sw_cgL2.Start();
-      CG_EMass.Mult(e_rhs, de);
+      {
+         LAGHOS_TRACE("cg_l2");
+         CG_EMass.Mult(e_rhs, de);
+      }
       timer.sw_cgL2.Stop();
-      const HYPRE_Int cg_num_iter = CG_EMass.GetNumIterations();
+      const int cg_num_iter = CG_EMass.GetNumIterations();
       timer.L2iter += (cg_num_iter==0) ? 1 : cg_num_iter;
       // Move the memory location of the subvector 'de' to the memory
       // location of the base vector 'dS_dt'.
@@ -455,17 +560,26 @@ void LagrangianHydroOperator::SolveEnergy(const Vector &S, const Vector &v,
       Force.MultTranspose(v, e_rhs);
       timer.sw_force.Stop();
       if (e_source) { e_rhs += *e_source; }
-      Vector loc_rhs(l2dofs_cnt), loc_de(l2dofs_cnt);
-      for (int e = 0; e < NE; e++)
+      e_rhs.HostRead();
+      de.HostReadWrite();
+      timer.sw_cgL2.Start();
+      LAGHOS_OMP(parallel)
       {
-         L2.GetElementDofs(e, l2dofs);
-         e_rhs.GetSubVector(l2dofs, loc_rhs);
-         timer.sw_cgL2.Start();
-         Me_inv(e).Mult(loc_rhs, loc_de);
-         timer.sw_cgL2.Stop();
-         timer.L2iter += 1;
-         de.SetSubVector(l2dofs, loc_de);
+         // One trace event per thread, without the final barrier.
+         LAGHOS_TRACE("energy_zones");
+         Array<int> l2dofs;
+         Vector loc_rhs(l2dofs_cnt), loc_de(l2dofs_cnt);
+         LAGHOS_OMP(for schedule(static) nowait)
+         for (int e = 0; e < NE; e++)
+         {
+            L2.GetElementDofs(e, l2dofs);
+            e_rhs.GetSubVector(l2dofs, loc_rhs);
+            Me_inv(e).Mult(loc_rhs, loc_de);
+            de.SetSubVector(l2dofs, loc_de);
+         }
       }
+      timer.sw_cgL2.Stop();
+      timer.L2iter += NE;
    }
    delete e_source;
 }
@@ -479,12 +593,45 @@ void LagrangianHydroOperator::UpdateMesh(const Vector &S) const
 
 double LagrangianHydroOperator::GetTimeStepEstimate(const Vector &S) const
 {
+   StartTimeStepEstimate(S);
+   return FinishTimeStepEstimate();
+}
+
+void LagrangianHydroOperator::StartTimeStepEstimate(const Vector &S,
+                                                    const double *diag,
+                                                    const int ndiag) const
+{
+   MFEM_VERIFY(ndiag >= 0 && ndiag <= dt_red_max_diags,
+               "Too many diagnostics bundled with the dt estimate!");
+   MFEM_VERIFY(dt_red_req == MPI_REQUEST_NULL,
+               "The previous dt estimate reduction is still pending!");
+   timer.sw_dt_est.Start();
    UpdateMesh(S);
+   const double rt_qdata = timer.sw_qdata.RealTime();
    UpdateQuadratureData(S);
-   double glob_dt_est;
+   timer.rt_qdata_dt_est += timer.sw_qdata.RealTime() - rt_qdata;
+   timer.sw_dt_est.Stop();
+   // The reduction is posted right after the last quadrature update, so that
+   // the caller can overlap it with local work until the estimate is needed.
+   dt_red_size = 1 + ndiag;
+   dt_red_loc[0] = qdata.dt_est;
+   for (int i = 0; i < ndiag; i++) { dt_red_loc[1 + i] = diag[i]; }
    const MPI_Comm comm = H1.GetParMesh()->GetComm();
-   MPI_Allreduce(&qdata.dt_est, &glob_dt_est, 1, MPI_DOUBLE, MPI_MIN, comm);
-   return glob_dt_est;
+   MPI_Iallreduce(dt_red_loc, dt_red_glob, dt_red_size, MPI_DOUBLE,
+                  dt_red_op, comm, &dt_red_req);
+}
+
+double LagrangianHydroOperator::FinishTimeStepEstimate(double *diag) const
+{
+   MFEM_VERIFY(dt_red_size > 0, "No dt estimate reduction was started!");
+   LAGHOS_TRACE("dt_reduce_wait");
+   MPI_Wait(&dt_red_req, MPI_STATUS_IGNORE);
+   if (diag)
+   {
+      for (int i = 1; i < dt_red_size; i++) { diag[i - 1] = dt_red_glob[i]; }
+   }
+   dt_red_size = 0;
+   return dt_red_glob[0];
 }
 
 void LagrangianHydroOperator::ResetTimeStepEstimate() const
@@ -492,153 +639,373 @@ void LagrangianHydroOperator::ResetTimeStepEstimate() const
    qdata.dt_est = std::numeric_limits<double>::infinity();
 }
 
-void LagrangianHydroOperator::ComputeDensity(ParGridFunction &rho) const
+// Time-invariant right-hand side of the zonal density projection,
+// b_i = sum_q phi_i(x_q) rho0DetJ0w(x_q), because rho detJ = rho0 detJ0.
+static void DensityRHS(const int NE, const int NQ, const int ND,
+                       const Array<double> &B_, const Vector &rho0DetJ0w,
+                       Vector &rhs)
 {
-   rho.SetSpace(&L2);
-   DenseMatrix Mrho(l2dofs_cnt);
-   Vector rhs(l2dofs_cnt), rho_z(l2dofs_cnt);
-   Array<int> dofs(l2dofs_cnt);
-   DenseMatrixInverse inv(&Mrho);
-   MassIntegrator mi(&ir);
-   DensityIntegrator di(qdata);
-   di.SetIntRule(&ir);
-   for (int e = 0; e < NE; e++)
+   const auto B = Reshape(B_.Read(), NQ, ND);
+   const auto R = Reshape(rho0DetJ0w.Read(), NQ, NE);
+   auto b = Reshape(rhs.Write(), ND, NE);
+   MFEM_FORALL(e, NE,
    {
-      const FiniteElement &fe = *L2.GetFE(e);
-      ElementTransformation &eltr = *L2.GetElementTransformation(e);
-      di.AssembleRHSElementVect(fe, eltr, rhs);
-      mi.AssembleElementMatrix(fe, eltr, Mrho);
-      inv.Factor();
-      inv.Mult(rhs, rho_z);
-      L2.GetElementDofs(e, dofs);
-      rho.SetSubVector(dofs, rho_z);
-   }
+      for (int i = 0; i < ND; i++)
+      {
+         double s = 0.0;
+         for (int q = 0; q < NQ; q++) { s += B(q,i) * R(q,e); }
+         b(i,e) = s;
+      }
+   });
 }
 
-
-
-double ComputeVolumeIntegral(const int DIM, const int NE,const int NQ,
-                             const int Q1D,const int VDIM,const double ln_norm,
-                             const mfem::Vector& mass, const mfem::Vector& f)
+// Largest number of L2 dofs per zone of the batched density projection: order
+// 3 in 3D, order 7 in 2D. Higher orders use the element-by-element path, which
+// bounds the size of the scratch E-vector of the packed local matrices.
+static constexpr int dens_max_nd = 64;
+
+// Batched L2 projection of the density in each zone. The local mass matrices
+// of the current mesh are formed at the quadrature points from the Jacobians,
+// factored in place (Cholesky) and solved, one element per thread. The lower
+// triangle of each local matrix is packed in thread-local storage of the exact
+// size when the number of dofs T_ND is a template parameter, and in the
+// scratch E-vector tri otherwise, so no thread holds a large array.
+template<int DIM, int T_ND = 0> static
+void DensityProjection(const int NE, const int NQ, const int nd,
+                       const Array<double> &B_, const Array<double> &W_,
+                       const Vector &Jacobians, const Vector &rhs,
+                       Vector &tri, Vector &rho_e)
 {
-
-   auto f_vals = mfem::Reshape(f.Read(),VDIM,NQ, NE);
-   mfem::Vector integrand(NE*NQ);
-   auto I = Reshape(integrand.Write(), NQ, NE);
-
-   if (DIM == 1)
+   constexpr int DIM2 = DIM*DIM;
+   constexpr int LOC_TRI = T_ND ? T_ND*(T_ND+1)/2 : 1;
+   const int ND = T_ND ? T_ND : nd;
+   const int NT = ND*(ND+1)/2;
+   if (!T_ND) { tri.SetSize(NT*NE); }
+   const auto B = Reshape(B_.Read(), NQ, ND);
+   const auto W = W_.Read();
+   const auto J = Jacobians.Read();
+   const auto b = Reshape(rhs.Read(), ND, NE);
+   auto T = T_ND ? nullptr : tri.Write();
+   auto rho = Reshape(rho_e.Write(), ND, NE);
+   MFEM_FORALL(e, NE,
    {
-      for (int e=0; e < NE; ++e)
+      // M(i,j), j <= i, is stored at i*(i+1)/2 + j.
+      double M_loc[LOC_TRI];
+      double *M = T_ND ? M_loc : T + NT*e;
+      // Lower triangle of M_ij = sum_q phi_i phi_j detJ w at the current mesh.
+      for (int k = 0; k < NT; k++) { M[k] = 0.0; }
+      for (int q = 0; q < NQ; q++)
       {
-         for (int q = 0; q < NQ; ++q)
+         const double detJw = W[q] * kernels::Det<DIM>(J + DIM2*(NQ*e + q));
+         for (int i = 0; i < ND; i++)
          {
-            double vmag = 0;
-            for (int k = 0; k < VDIM; k++)
-            {
-               vmag += pow(f_vals(k,q,e),ln_norm);
-            }
-            I(q,e) = vmag;
+            const double Bi = B(q,i) * detJw;
+            double *Mi = M + i*(i+1)/2;
+            for (int j = 0; j <= i; j++) { Mi[j] += Bi * B(q,j); }
          }
       }
-   }
-   else if (DIM == 2)
-   {
-      MFEM_FORALL_2D(e, NE, Q1D, Q1D, 1,
+      // M = L L^T, with L stored in place of M.
+      for (int j = 0; j < ND; j++)
       {
-         MFEM_FOREACH_THREAD(qy,y,Q1D)
+         double *Mj = M + j*(j+1)/2;
+         double d = Mj[j];
+         for (int k = 0; k < j; k++) { d -= Mj[k] * Mj[k]; }
+         d = sqrt(d);
+         Mj[j] = d;
+         for (int i = j + 1; i < ND; i++)
          {
-            MFEM_FOREACH_THREAD(qx,x,Q1D)
-            {
-               const int q = qx + qy * Q1D;
-               double vmag = 0;
-               for (int k = 0; k < VDIM; k++)
-               {
-                  vmag += pow(f_vals(k,q,e),ln_norm);
-               }
-               I(q,e) = vmag;
-            }
+            double *Mi = M + i*(i+1)/2;
+            double u = Mi[j];
+            for (int k = 0; k < j; k++) { u -= Mi[k] * Mj[k]; }
+            Mi[j] = u / d;
          }
-      });
+      }
+      // Forward and backward substitutions.
+      for (int i = 0; i < ND; i++)
+      {
+         const double *Mi = M + i*(i+1)/2;
+         double u = b(i,e);
+         for (int k = 0; k < i; k++) { u -= Mi[k] * rho(k,e); }
+         rho(i,e) = u / Mi[i];
+      }
+      for (int i = ND - 1; i >= 0; i--)
+      {
+         double u = rho(i,e);
+         for (int k = i + 1; k < ND; k++) { u -= M[k*(k+1)/2 + i] * rho(k,e); }
+         rho(i,e) = u / M[i*(i+1)/2 + i];
+      }
+   });
+}
+
+static void DensityProjection(const int dim, const int NE, const int NQ,
+                              const int ND, const Array<double> &B,
+                              const Array<double> &W, const Vector &J,
+                              const Vector &rhs, Vector &tri, Vector &rho_e)
+{
+   // The L2 dofs of quadrilaterals and hexahedra up to order 3 and 2.
+   const int id = (dim << 8) | ND;
+   switch (id)
+   {
+      case 0x201: return DensityProjection<2,1>(NE, NQ, ND, B, W, J, rhs,
+                                                   tri, rho_e);
+      case 0x204: return DensityProjection<2,4>(NE, NQ, ND, B, W, J, rhs,
+                                                   tri, rho_e);
+      case 0x209: return DensityProjection<2,9>(NE, NQ, ND, B, W, J, rhs,
+                                                   tri, rho_e);
+      case 0x210: return DensityProjection<2,16>(NE, NQ, ND, B, W, J, rhs,
+                                                    tri, rho_e);
+      case 0x301: return DensityProjection<3,1>(NE, NQ, ND, B, W, J, rhs,
+                                                   tri, rho_e);
+      case 0x308: return DensityProjection<3,8>(NE, NQ, ND, B, W, J, rhs,
+                                                   tri, rho_e);
+      case 0x31B: return DensityProjection<3,27>(NE, NQ, ND, B, W, J, rhs,
+                                                    tri, rho_e);
+      default:
+         if (dim == 2)
+         {
+            return DensityProjection<2>(NE, NQ, ND, B, W, J, rhs, tri, rho_e);
+         }
+         return DensityProjection<3>(NE, NQ, ND, B, W, J, rhs, tri, rho_e);
    }
-   else if (DIM == 3)
+}
+
+void LagrangianHydroOperator::ComputeDensity(ParGridFunction &rho) const
+{
+   rho.SetSpace(&L2);
+   if (dim == 1 || l2dofs_cnt > dens_max_nd)
    {
-      MFEM_FORALL_3D(e, NE, Q1D, Q1D, Q1D,
+      LAGHOS_OMP_FE(parallel)
       {
-         MFEM_FOREACH_THREAD(qz,z,Q1D)
+         LAGHOS_TRACE("density_zones");
+         DenseMatrix Mrho(l2dofs_cnt);
+         Vector rhs(l2dofs_cnt), rho_z(l2dofs_cnt);
+         Array<int> dofs(l2dofs_cnt);
+         DenseMatrixInverse inv(&Mrho);
+         MassIntegrator mi(&ir);
+         DensityIntegrator di(qdata);
+         di.SetIntRule(&ir);
+         IsoparametricTransformation eltr;
+         LAGHOS_OMP_FE(for schedule(static) nowait)
+         for (int e = 0; e < NE; e++)
          {
-            MFEM_FOREACH_THREAD(qy,y,Q1D)
-            {
-               MFEM_FOREACH_THREAD(qx,x,Q1D)
-               {
-                  const int q = qx + (qy + qz * Q1D) * Q1D;
-                  double vmag = 0;
-                  for (int k = 0; k < VDIM; k++)
-                  {
-                     vmag += pow(f_vals(k,q,e),ln_norm);
-                  }
-                  I(q,e) = vmag;
-               }
-            }
+            const FiniteElement &fe = *L2.GetFE(e);
+            pmesh->GetElementTransformation(e, &eltr);
+            di.AssembleRHSElementVect(fe, eltr, rhs);
+            mi.AssembleElementMatrix(fe, eltr, Mrho);
+            inv.Factor();
+            inv.Mult(rhs, rho_z);
+            L2.GetElementDofs(e, dofs);
+            rho.SetSubVector(dofs, rho_z);
          }
-      });
-
+      }
+      return;
    }
-   const double integral = integrand * mass;
-   return integral;
 
+   const int NQ = ir.GetNPoints();
+   const int ND = l2dofs_cnt;
+   const DofToQuad &maps = L2.GetFE(0)->GetDofToQuad(ir, DofToQuad::FULL);
+   const Operator *L2r = L2.GetElementRestriction(ElementDofOrdering::NATIVE);
+   const Operator *H1r =
+      H1.GetElementRestriction(ElementDofOrdering::LEXICOGRAPHIC);
+   const QuadratureInterpolator *h1_qi = H1.GetQuadratureInterpolator(ir);
+   h1_qi->SetOutputLayout(QVectorLayout::byVDIM);
+
+   // The right-hand side depends only on rho0DetJ0w, so it is formed once.
+   if (dens_rhs.Size() != ND*NE)
+   {
+      dens_rhs.SetSize(ND*NE);
+      DensityRHS(NE, NQ, ND, maps.B, qdata.rho0DetJ0w, dens_rhs);
+   }
+   dens_x_vec.SetSize(H1r->Height());
+   dens_J.SetSize(dim*dim*NQ*NE);
+   dens_rho_vec.SetSize(ND*NE);
+
+   // Jacobians of the current mesh at the quadrature points.
+   H1r->Mult(*pmesh->GetNodes(), dens_x_vec);
+   h1_qi->Derivatives(dens_x_vec, dens_J);
+
+   DensityProjection(dim, NE, NQ, ND, maps.B, ir.GetWeights(), dens_J,
+                     dens_rhs, dens_tri, dens_rho_vec);
+   if (L2r) { L2r->MultTranspose(dens_rho_vec, rho); }
+   else { rho = dens_rho_vec; }
 }
-double LagrangianHydroOperator::InternalEnergy(const ParGridFunction &gf) const
+
+// Per-element partial sums of the energy diagnostics: for each element e,
+// P(0,e) is the internal energy, P(1,e) the kinetic energy and P(2,e) the sum
+// of the squares of the specific internal energy dofs.
+static void EnergyPartials(const int NE, const int NQ, const int ND,
+                           const int VDIM, const Vector &rho0DetJ0w,
+                           const Vector &e_vec, const Vector &e_qp,
+                           const Vector &v_qp, Vector &partials)
 {
-   double glob_ie = 0.0;
+   const auto W = Reshape(rho0DetJ0w.Read(), NQ, NE);
+   const auto E = Reshape(e_vec.Read(), ND, NE);
+   const auto EQ = Reshape(e_qp.Read(), NQ, NE);
+   const auto VQ = Reshape(v_qp.Read(), VDIM, NQ, NE);
+   auto P = Reshape(partials.Write(), 3, NE);
+   MFEM_FORALL(e, NE,
+   {
+      double ie = 0.0, ke = 0.0, e2 = 0.0;
+      for (int q = 0; q < NQ; q++)
+      {
+         double v2 = 0.0;
+         for (int k = 0; k < VDIM; k++) { v2 += VQ(k,q,e) * VQ(k,q,e); }
+         // Note that rho * detJ * w = rho0 * detJ0 * w.
+         ie += W(q,e) * EQ(q,e);
+         ke += W(q,e) * v2;
+      }
+      for (int d = 0; d < ND; d++) { e2 += E(d,e) * E(d,e); }
+      P(0,e) = ie;
+      P(1,e) = 0.5 * ke;
+      P(2,e) = e2;
+   });
+}
 
-   // get the restriction and interpolator objects
-   const QuadratureInterpolator* l2_interpolator = L2.GetQuadratureInterpolator(
-                                                      ir);
-   l2_interpolator->SetOutputLayout(QVectorLayout::byVDIM);
-   auto L2r = L2.GetElementRestriction(ElementDofOrdering::LEXICOGRAPHIC);
+void LagrangianHydroOperator::LocalEnergyDiagnostics(const ParGridFunction &e,
+                                                     const ParGridFunction &v,
+                                                     double diag[3]) const
+{
    const int NQ = ir.GetNPoints();
    const int ND = L2.GetFE(0)->GetDof();
-   Vector e_vector(NE*ND), eintQ(NE*NQ);
-
-   // Get internal energy at the quadrature points
-   L2r->Mult(gf, e_vector);
-   l2_interpolator->Values(e_vector, eintQ);
-
-   double internal_energy = ComputeVolumeIntegral(dim,NE,NQ,Q1D,1,1.0,
-                                                  qdata.rho0DetJ0w,eintQ);
+   const QuadratureInterpolator *l2_qi = L2.GetQuadratureInterpolator(ir);
+   const QuadratureInterpolator *h1_qi = H1.GetQuadratureInterpolator(ir);
+   l2_qi->SetOutputLayout(QVectorLayout::byVDIM);
+   h1_qi->SetOutputLayout(QVectorLayout::byVDIM);
+   const ElementDofOrdering ordering = ElementDofOrdering::LEXICOGRAPHIC;
+   const Operator *L2r = L2.GetElementRestriction(ordering);
+   const Operator *H1r = H1.GetElementRestriction(ordering);
+   diag_e_vec.SetSize(NE*ND);
+   diag_e_qp.SetSize(NE*NQ);
+   diag_v_vec.SetSize(H1r->Height());
+   diag_v_qp.SetSize(dim*NE*NQ);
+   diag_part.SetSize(3*NE);
+
+   if (L2r) { L2r->Mult(e, diag_e_vec); }
+   else { diag_e_vec = e; }
+   l2_qi->Values(diag_e_vec, diag_e_qp);
+   H1r->Mult(v, diag_v_vec);
+   h1_qi->Values(diag_v_vec, diag_v_qp);
+
+   EnergyPartials(NE, NQ, ND, dim, qdata.rho0DetJ0w,
+                  diag_e_vec, diag_e_qp, diag_v_qp, diag_part);
+
+   const double *P = diag_part.HostRead();
+   diag[0] = diag[1] = diag[2] = 0.0;
+   for (int k = 0; k < NE; k++)
+   {
+      diag[0] += P[3*k + 0];
+      diag[1] += P[3*k + 1];
+      diag[2] += P[3*k + 2];
+   }
+}
 
-   MPI_Allreduce(&internal_energy, &glob_ie, 1, MPI_DOUBLE, MPI_SUM,
-                 L2.GetParMesh()->GetComm());
+void LagrangianHydroOperator::EnergyDiagnostics(const ParGridFunction &e,
+                                                const ParGridFunction &v,
+                                                double diag[3]) const
+{
+   double loc_diag[3];
+   LocalEnergyDiagnostics(e, v, loc_diag);
+   LAGHOS_TRACE("energy_reduce");
+   MPI_Allreduce(loc_diag, diag, 3, MPI_DOUBLE, MPI_SUM, H1.GetComm());
+}
 
-   return glob_ie;
+MFEM_HOST_DEVICE static inline double Determinant(const int dim,
+                                                  const double *J)
+{
+   if (dim == 1) { return J[0]; }
+   if (dim == 2) { return J[0]*J[3] - J[1]*J[2]; }
+   return J[0]*(J[4]*J[8] - J[5]*J[7]) - J[1]*(J[3]*J[8] - J[5]*J[6]) +
+          J[2]*(J[3]*J[7] - J[4]*J[6]);
 }
 
-double LagrangianHydroOperator::KineticEnergy(const ParGridFunction &v) const
+// Density and initial density at the quadrature points, from the mass of each
+// point, rho0 * det(J0) * w, and the Jacobians of the current mesh.
+static void QuadratureDensities(const int NE, const int NQ, const int DIM,
+                                const Array<double> &W_,
+                                const Vector &rho0DetJ0w,
+                                const DenseTensor &Jac0inv,
+                                const Vector &Jacobians,
+                                Vector &rho_qp, Vector &rho0_qp)
 {
-   double glob_ke = 0.0;
+   const int DIM2 = DIM*DIM;
+   const auto W = W_.Read();
+   const auto M = Reshape(rho0DetJ0w.Read(), NQ, NE);
+   const auto J0i = Read(Jac0inv.GetMemory(), Jac0inv.TotalSize());
+   const auto J = Jacobians.Read();
+   auto rho = Reshape(rho_qp.Write(), NQ, NE);
+   auto rho0 = Reshape(rho0_qp.Write(), NQ, NE);
+   MFEM_FORALL(e, NE,
+   {
+      for (int q = 0; q < NQ; q++)
+      {
+         const int eq = NQ*e + q;
+         rho(q,e) = M(q,e) / (W[q] * Determinant(DIM, J + DIM2*eq));
+         rho0(q,e) = M(q,e) * Determinant(DIM, J0i + DIM2*eq) / W[q];
+      }
+   });
+}
 
-   // get the restriction and interpolator objects
-   const QuadratureInterpolator* h1_interpolator = H1.GetQuadratureInterpolator(
-                                                      ir);
-   h1_interpolator->SetOutputLayout(QVectorLayout::byVDIM);
-   auto H1r = H1.GetElementRestriction(ElementDofOrdering::LEXICOGRAPHIC);
+void LagrangianHydroOperator::ComputeQuadratureFields(
+   const Vector &S, QuadratureFields &qf) const
+{
    const int NQ = ir.GetNPoints();
-   const int ND = H1.GetFE(0)->GetDof();
-   Vector e_vector(dim*NE*ND), ekinQ(dim*NE*NQ);
-
-   // Get internal energy at the quadrature points
-   H1r->Mult(v, e_vector);
-   h1_interpolator->Values(e_vector, ekinQ);
+   const QuadratureInterpolator *l2_qi = L2.GetQuadratureInterpolator(ir);
+   const QuadratureInterpolator *h1_qi = H1.GetQuadratureInterpolator(ir);
+   l2_qi->SetOutputLayout(QVectorLayout::byVDIM);
+   h1_qi->SetOutputLayout(QVectorLayout::byVDIM);
+   const ElementDofOrdering ordering = ElementDofOrdering::LEXICOGRAPHIC;
+   const Operator *L2r = L2.GetElementRestriction(ordering);
+   const Operator *H1r = H1.GetElementRestriction(ordering);
 
-   // Get the IE, initial weighted mass
+   ParGridFunction x, v, e;
+   Vector *sptr = const_cast<Vector*>(&S);
+   x.MakeRef(&H1, *sptr, 0);
+   v.MakeRef(&H1, *sptr, H1.GetVSize());
+   e.MakeRef(&L2, *sptr, 2*H1.GetVSize());
 
-   double kinetic_energy = ComputeVolumeIntegral(dim,NE,NQ,Q1D,dim,2.0,
-                                                 qdata.rho0DetJ0w,ekinQ);
+   diag_e_vec.SetSize(NE*l2dofs_cnt);
+   diag_v_vec.SetSize(H1r->Height());
+   dens_J.SetSize(dim*dim*NQ*NE);
+   qf.x.SetSize(dim*NQ*NE);
+   qf.v.SetSize(dim*NQ*NE);
+   qf.rho.SetSize(NQ*NE);
+   qf.e.SetSize(NQ*NE);
+   qf.rho0.SetSize(NQ*NE);
+
+   H1r->Mult(x, diag_v_vec);
+   h1_qi->Values(diag_v_vec, qf.x);
+   h1_qi->Derivatives(diag_v_vec, dens_J);
+   H1r->Mult(v, diag_v_vec);
+   h1_qi->Values(diag_v_vec, qf.v);
+   if (L2r) { L2r->Mult(e, diag_e_vec); }
+   else { diag_e_vec = e; }
+   l2_qi->Values(diag_e_vec, qf.e);
+   qf.mass = qdata.rho0DetJ0w;
+   QuadratureDensities(NE, NQ, dim, ir.GetWeights(), qdata.rho0DetJ0w,
+                       qdata.Jac0inv, dens_J, qf.rho, qf.rho0);
+}
 
-   MPI_Allreduce(&kinetic_energy, &glob_ke, 1, MPI_DOUBLE, MPI_SUM,
-                 H1.GetParMesh()->GetComm());
+long long GlobalCount(MPI_Comm comm, const long long local)
+{
+   long long global;
+   MPI_Allreduce(&local, &global, 1, MPI_LONG_LONG, MPI_SUM, comm);
+   return global;
+}
 
-   return 0.5*glob_ke;
+FOMCounts GlobalFOMCounts(MPI_Comm comm, const TimingData &timer,
+                          const long long NE, const int QPT,
+                          const long long H1GTVSize,
+                          const long long L2GTVSize)
+{
+   long long mydata[3] = { timer.L2dof * timer.L2iter, timer.quad_tstep, NE };
+   long long alldata[3];
+   MPI_Allreduce(mydata, alldata, 3, MPI_LONG_LONG, MPI_SUM, comm);
+   FOMCounts counts;
+   counts.L2dof_iter = alldata[0];
+   counts.quad_tstep = alldata[1];
+   counts.zones = alldata[2];
+   counts.ndofs = 2 * H1GTVSize + L2GTVSize + QPT * counts.zones;
+   return counts;
 }
 
 void LagrangianHydroOperator::PrintTimingData(bool IamRoot, int steps,
@@ -646,27 +1013,25 @@ void LagrangianHydroOperator::PrintTimingData(bool IamRoot, int steps,
 {
    const MPI_Comm com = H1.GetComm();
    double my_rt[5], T[5];
-   my_rt[0] = timer.sw_cgH1.RealTime();
-   my_rt[1] = timer.sw_cgL2.RealTime();
-   my_rt[2] = timer.sw_force.RealTime();
-   my_rt[3] = timer.sw_qdata.RealTime();
+   my_rt[0] = timer.rt_restart[0] + timer.sw_cgH1.RealTime();
+   my_rt[1] = timer.rt_restart[1] + timer.sw_cgL2.RealTime();
+   my_rt[2] = timer.rt_restart[2] + timer.sw_force.RealTime();
+   my_rt[3] = timer.rt_restart[3] + timer.sw_qdata.RealTime();
    my_rt[4] = my_rt[0] + my_rt[2] + my_rt[3];
    MPI_Reduce(my_rt, T, 5, MPI_DOUBLE, MPI_MAX, 0, com);
 
-   HYPRE_Int mydata[3], alldata[3];
-   mydata[0] = timer.L2dof * timer.L2iter;
-   mydata[1] = timer.quad_tstep;
-   mydata[2] = NE;
-   MPI_Reduce(mydata, alldata, 3, HYPRE_MPI_INT, MPI_SUM, 0, com);
+   const int QPT = ir.GetNPoints();
+   const FOMCounts counts = GlobalFOMCounts(com, timer, NE, QPT, H1GTVSize,
+                                            L2GTVSize);
 
    if (IamRoot)
    {
       using namespace std;
       // FOM = (FOM1 * T1 + FOM2 * T2 + FOM3 * T3) / (T1 + T2 + T3)
-      const HYPRE_Int H1iter = p_assembly ? (timer.H1iter/dim) : timer.H1iter;
+      const long long H1iter = p_assembly ? (timer.H1iter/dim) : timer.H1iter;
       const double FOM1 = 1e-6 * H1GTVSize * H1iter / T[0];
       const double FOM2 = 1e-6 * steps * (H1GTVSize + L2GTVSize) / T[2];
-      const double FOM3 = 1e-6 * alldata[1] * ir.GetNPoints() / T[3];
+      const double FOM3 = 1e-6 * counts.quad_tstep * QPT / T[3];
       const double FOM = (FOM1 * T[0] + FOM2 * T[2] + FOM3 * T[3]) / T[4];
       const double FOM0 = 1e-6 * steps * (H1GTVSize + L2GTVSize) / T[4];
       cout << endl;
@@ -676,7 +1041,7 @@ void LagrangianHydroOperator::PrintTimingData(bool IamRoot, int steps,
       cout << endl;
       cout << "CG (L2) total time: " << T[1] << endl;
       cout << "CG (L2) rate (megadofs x cg_iterations / second): "
-           << 1e-6 * alldata[0] / T[1] << endl;
+           << 1e-6 * counts.L2dof_iter / T[1] << endl;
       cout << endl;
       cout << "Forces total time: " << T[2] << endl;
       cout << "Forces rate (megadofs x timesteps / second): "
@@ -690,9 +1055,8 @@ void LagrangianHydroOperator::PrintTimingData(bool IamRoot, int steps,
       cout << "Major kernels total rate (megadofs x time steps / second): "
            << FOM << endl;
       if (!fom) { return; }
-      const int QPT = ir.GetNPoints();
-      const HYPRE_Int GNZones = alldata[2];
-      const long ndofs = 2*H1GTVSize + L2GTVSize + QPT*GNZones;
+      const long long GNZones = counts.zones;
+      const long long ndofs = counts.ndofs;
       cout << endl;
       cout << "| Ranks " << "| Zones   "
            << "| H1 dofs " << "| L2 dofs "
@@ -723,6 +1087,56 @@ void LagrangianHydroOperator::PrintTimingData(bool IamRoot, int steps,
    }
 }
 
+void LagrangianHydroOperator::PrintPhaseTimers(bool IamRoot) const
+{
+   const int nphases = 9;
+   const char *names[nphases] =
+   {
+      "time step", "RK stage", "quadrature data", "force", "CG (H1)",
+      "CG (L2)", "halo exchange", "dt estimate", "output"
+   };
+   const int depth[nphases] = { 0, 1, 2, 2, 2, 2, 2, 1, 1 };
+   StopWatch *sw[nphases] =
+   {
+      &timer.sw_step, &timer.sw_stage, &timer.sw_qdata, &timer.sw_force,
+      &timer.sw_cgH1, &timer.sw_cgL2, &timer.sw_halo, &timer.sw_dt_est,
+      &timer.sw_output
+   };
+   // The times of the run segments before a restart.
+   const double *rp = timer.rt_restart_phase, *rt = timer.rt_restart;
+   const double t_restart[nphases] =
+   {
+      rp[0], rp[1], rt[3], rt[2], rt[0], rt[1], rp[3], rp[2], rp[4]
+   };
+   double my_t[nphases], t_min[nphases], t_max[nphases], t_sum[nphases];
+   for (int p = 0; p < nphases; p++)
+   {
+      my_t[p] = t_restart[p] + sw[p]->RealTime();
+   }
+   // The quadrature data of the time step estimates is part of their own row.
+   my_t[2] -= timer.rt_qdata_dt_est;
+   const MPI_Comm com = H1.GetComm();
+   MPI_Reduce(my_t, t_min, nphases, MPI_DOUBLE, MPI_MIN, 0, com);
+   MPI_Reduce(my_t, t_max, nphases, MPI_DOUBLE, MPI_MAX, 0, com);
+   MPI_Reduce(my_t, t_sum, nphases, MPI_DOUBLE, MPI_SUM, 0, com);
+   if (!IamRoot) { return; }
+
+   using namespace std;
+   const int nranks = H1.GetNRanks();
+   cout << endl << left << setw(22) << "Phase times (seconds)" << right
+        << setw(11) << "min" << setw(11) << "avg" << setw(11) << "max"
+        << setw(10) << "max/avg" << endl;
+   for (int p = 0; p < nphases; p++)
+   {
+      const double avg = t_sum[p] / nranks;
+      const string name = string(2*depth[p], ' ') + names[p];
+      cout << left << setw(22) << name << right << scientific
+           << setprecision(3) << setw(11) << t_min[p] << setw(11) << avg
+           << setw(11) << t_max[p] << fixed << setprecision(2) << setw(10)
+           << ((avg > 0.0) ? t_max[p] / avg : 1.0) << endl;
+   }
+}
+
 // Smooth transition between 0 and 1 for x in [-eps, eps].
 MFEM_HOST_DEVICE inline double smooth_step_01(double x, double eps)
 {
@@ -738,6 +1152,7 @@ void LagrangianHydroOperator::UpdateQuadratureData(const Vector &S) const
 
    qdata_is_current = true;
    forcemat_is_assembled = false;
+   LAGHOS_TRACE("qupdate");
 
    if (dim > 1 && p_assembly) { return qupdate->UpdateQuadratureData(S, qdata); }
 
@@ -749,161 +1164,163 @@ void LagrangianHydroOperator::UpdateQuadratureData(const Vector &S) const
    x.MakeRef(&H1, *sptr, 0);
    v.MakeRef(&H1, *sptr, H1.GetVSize());
    e.MakeRef(&L2, *sptr, 2*H1.GetVSize());
-   Vector e_vals;
-   DenseMatrix Jpi(dim), sgrad_v(dim), Jinv(dim), stress(dim), stressJiT(dim);
 
    // Batched computations are needed, because hydrodynamic codes usually
    // involve expensive computations of material properties. Although this
    // miniapp uses simple EOS equations, we still want to represent the batched
-   // cycle structure.
-   int nzones_batch = 3;
-   const int nbatches =  NE / nzones_batch + 1; // +1 for the remainder.
-   int nqp_batch = nqp * nzones_batch;
-   double *gamma_b = new double[nqp_batch],
-   *rho_b = new double[nqp_batch],
-   *e_b   = new double[nqp_batch],
-   *p_b   = new double[nqp_batch],
-   *cs_b  = new double[nqp_batch];
-   // Jacobians of reference->physical transformations for all quadrature points
-   // in the batch.
-   DenseTensor *Jpr_b = new DenseTensor[nzones_batch];
-   for (int b = 0; b < nbatches; b++)
+   // cycle structure. The batches are distributed among the OpenMP threads.
+   const int nzones_batch_max = 3;
+   const int nbatches = (NE + nzones_batch_max - 1) / nzones_batch_max;
+   double dt_est = qdata.dt_est;
+   LAGHOS_OMP_FE(parallel reduction(min:dt_est))
    {
-      int z_id = b * nzones_batch; // Global index over zones.
-      // The last batch might not be full.
-      if (z_id == NE) { break; }
-      else if (z_id + nzones_batch > NE)
+      LAGHOS_TRACE("qdata_zones");
+      Vector e_vals;
+      DenseMatrix Jpi(dim), sgrad_v(dim), Jinv(dim);
+      DenseMatrix stress(dim), stressJiT(dim);
+      IsoparametricTransformation T;
+      const int nqp_batch_max = nqp * nzones_batch_max;
+      Vector gamma_b(nqp_batch_max), rho_b(nqp_batch_max), e_b(nqp_batch_max),
+             p_b(nqp_batch_max), cs_b(nqp_batch_max);
+      // Jacobians of reference->physical transformations for all quadrature
+      // points in the batch.
+      DenseTensor Jpr_b[nzones_batch_max];
+      LAGHOS_OMP_FE(for schedule(static) nowait)
+      for (int b = 0; b < nbatches; b++)
       {
-         nzones_batch = NE - z_id;
-         nqp_batch    = nqp * nzones_batch;
-      }
+         int z_id = b * nzones_batch_max; // Global index over zones.
+         // The last batch might not be full.
+         const int nzones_batch = std::min(nzones_batch_max, NE - z_id);
+         const int nqp_batch = nqp * nzones_batch;
 
-      double min_detJ = std::numeric_limits<double>::infinity();
-      for (int z = 0; z < nzones_batch; z++)
-      {
-         ElementTransformation *T = H1.GetElementTransformation(z_id);
-         Jpr_b[z].SetSize(dim, dim, nqp);
-         e.GetValues(z_id, ir, e_vals);
-         for (int q = 0; q < nqp; q++)
+         double min_detJ = std::numeric_limits<double>::infinity();
+         for (int z = 0; z < nzones_batch; z++)
          {
-            const IntegrationPoint &ip = ir.IntPoint(q);
-            T->SetIntPoint(&ip);
-            Jpr_b[z](q) = T->Jacobian();
-            const double detJ = Jpr_b[z](q).Det();
-            min_detJ = fmin(min_detJ, detJ);
-            const int idx = z * nqp + q;
-            // Assuming piecewise constant gamma that moves with the mesh.
-            gamma_b[idx] = gamma_gf(z_id);
-            rho_b[idx] = qdata.rho0DetJ0w(z_id*nqp + q) / detJ / ip.weight;
-            e_b[idx] = fmax(0.0, e_vals(q));
+            pmesh->GetElementTransformation(z_id, &T);
+            Jpr_b[z].SetSize(dim, dim, nqp);
+            e.GetValues(T, ir, e_vals);
+            for (int q = 0; q < nqp; q++)
+            {
+               const IntegrationPoint &ip = ir.IntPoint(q);
+               T.SetIntPoint(&ip);
+               Jpr_b[z](q) = T.Jacobian();
+               const double detJ = Jpr_b[z](q).Det();
+               min_detJ = fmin(min_detJ, detJ);
+               const int idx = z * nqp + q;
+               // Assuming piecewise constant gamma that moves with the mesh.
+               gamma_b(idx) = gamma_gf(z_id);
+               rho_b(idx) = qdata.rho0DetJ0w(z_id*nqp + q) / detJ / ip.weight;
+               e_b(idx) = fmax(0.0, e_vals(q));
+            }
+            ++z_id;
          }
-         ++z_id;
-      }
 
-      // Batched computation of material properties.
-      ComputeMaterialProperties(nqp_batch, gamma_b, rho_b, e_b, p_b, cs_b);
+         // Batched computation of material properties.
+         ComputeMaterialProperties(nqp_batch, gamma_b.GetData(),
+                                   rho_b.GetData(), e_b.GetData(),
+                                   p_b.GetData(), cs_b.GetData());
 
-      z_id -= nzones_batch;
-      for (int z = 0; z < nzones_batch; z++)
-      {
-         ElementTransformation *T = H1.GetElementTransformation(z_id);
-         for (int q = 0; q < nqp; q++)
+         z_id -= nzones_batch;
+         for (int z = 0; z < nzones_batch; z++)
          {
-            const IntegrationPoint &ip = ir.IntPoint(q);
-            T->SetIntPoint(&ip);
-            // Note that the Jacobian was already computed above. We've chosen
-            // not to store the Jacobians for all batched quadrature points.
-            const DenseMatrix &Jpr = Jpr_b[z](q);
-            CalcInverse(Jpr, Jinv);
-            const double detJ = Jpr.Det(), rho = rho_b[z*nqp + q],
-                         p = p_b[z*nqp + q], sound_speed = cs_b[z*nqp + q];
-            stress = 0.0;
-            for (int d = 0; d < dim; d++) { stress(d, d) = -p; }
-            double visc_coeff = 0.0;
-            if (use_viscosity)
+            pmesh->GetElementTransformation(z_id, &T);
+            for (int q = 0; q < nqp; q++)
             {
-               // Compression-based length scale at the point. The first
-               // eigenvector of the symmetric velocity gradient gives the
-               // direction of maximal compression. This is used to define the
-               // relative change of the initial length scale.
-               v.GetVectorGradient(*T, sgrad_v);
-
-               double vorticity_coeff = 1.0;
-               if (use_vorticity)
+               const IntegrationPoint &ip = ir.IntPoint(q);
+               T.SetIntPoint(&ip);
+               // Note that the Jacobian was already computed above. We've
+               // chosen not to store the Jacobians for all batched quadrature
+               // points.
+               const DenseMatrix &Jpr = Jpr_b[z](q);
+               CalcInverse(Jpr, Jinv);
+               const double detJ = Jpr.Det(), rho = rho_b(z*nqp + q),
+                            p = p_b(z*nqp + q), sound_speed = cs_b(z*nqp + q);
+               stress = 0.0;
+               for (int d = 0; d < dim; d++) { stress(d, d) = -p; }
+               double visc_coeff = 0.0;
+               if (use_viscosity)
                {
-                  const double grad_norm = sgrad_v.FNorm();
-                  const double div_v = fabs(sgrad_v.Trace());
-                  vorticity_coeff = (grad_norm > 0.0) ? div_v / grad_norm : 1.0;
-               }
+                  // Compression-based length scale at the point. The first
+                  // eigenvector of the symmetric velocity gradient gives the
+                  // direction of maximal compression. This is used to define
+                  // the relative change of the initial length scale.
+                  v.GetVectorGradient(T, sgrad_v);
+
+                  double vorticity_coeff = 1.0;
+                  if (use_vorticity)
+                  {
+                     const double grad_norm = sgrad_v.FNorm();
+                     const double div_v = fabs(sgrad_v.Trace());
+                     vorticity_coeff = (grad_norm > 0.0) ?
+                                       div_v / grad_norm : 1.0;
+                  }
 
-               sgrad_v.Symmetrize();
-               double eig_val_data[3], eig_vec_data[9];
-               if (dim==1)
+                  sgrad_v.Symmetrize();
+                  double eig_val_data[3], eig_vec_data[9];
+                  if (dim==1)
+                  {
+                     eig_val_data[0] = sgrad_v(0, 0);
+                     eig_vec_data[0] = 1.;
+                  }
+                  else { sgrad_v.CalcEigenvalues(eig_val_data, eig_vec_data); }
+                  Vector compr_dir(eig_vec_data, dim);
+                  // Computes the initial->physical transformation Jacobian.
+                  mfem::Mult(Jpr, qdata.Jac0inv(z_id*nqp + q), Jpi);
+                  Vector ph_dir(dim); Jpi.Mult(compr_dir, ph_dir);
+                  // Change of the initial mesh size in the compression
+                  // direction.
+                  const double h = qdata.h0 * ph_dir.Norml2() /
+                                   compr_dir.Norml2();
+                  // Measure of maximal compression.
+                  const double mu = eig_val_data[0];
+                  visc_coeff = 2.0 * rho * h * h * fabs(mu);
+                  // The following represents a "smooth" version of the
+                  // statement "if (mu < 0) visc_coeff += 0.5 rho h sound_speed".
+                  // Note that eps must be scaled appropriately if a different
+                  // unit system is being used.
+                  const double eps = 1e-12;
+                  visc_coeff += 0.5 * rho * h * sound_speed * vorticity_coeff *
+                                (1.0 - smooth_step_01(mu - 2.0 * eps, eps));
+                  stress.Add(visc_coeff, sgrad_v);
+               }
+               // Time step estimate at the point. Here the more relevant
+               // length scale is related to the actual mesh deformation; we use
+               // the min singular value of the ref->physical Jacobian. In
+               // addition, the time step estimate should be aware of the
+               // presence of shocks.
+               const double h_min =
+                  Jpr.CalcSingularvalue(dim-1) / (double) H1.GetOrder(0);
+               const double inv_dt = sound_speed / h_min +
+                                     2.5 * visc_coeff / rho / h_min / h_min;
+               if (min_detJ < 0.0)
                {
-                  eig_val_data[0] = sgrad_v(0, 0);
-                  eig_vec_data[0] = 1.;
+                  // This will force repetition of the step with smaller dt.
+                  dt_est = 0.0;
                }
-               else { sgrad_v.CalcEigenvalues(eig_val_data, eig_vec_data); }
-               Vector compr_dir(eig_vec_data, dim);
-               // Computes the initial->physical transformation Jacobian.
-               mfem::Mult(Jpr, qdata.Jac0inv(z_id*nqp + q), Jpi);
-               Vector ph_dir(dim); Jpi.Mult(compr_dir, ph_dir);
-               // Change of the initial mesh size in the compression direction.
-               const double h = qdata.h0 * ph_dir.Norml2() /
-                                compr_dir.Norml2();
-               // Measure of maximal compression.
-               const double mu = eig_val_data[0];
-               visc_coeff = 2.0 * rho * h * h * fabs(mu);
-               // The following represents a "smooth" version of the statement
-               // "if (mu < 0) visc_coeff += 0.5 rho h sound_speed".  Note that
-               // eps must be scaled appropriately if a different unit system is
-               // being used.
-               const double eps = 1e-12;
-               visc_coeff += 0.5 * rho * h * sound_speed * vorticity_coeff *
-                             (1.0 - smooth_step_01(mu - 2.0 * eps, eps));
-               stress.Add(visc_coeff, sgrad_v);
-            }
-            // Time step estimate at the point. Here the more relevant length
-            // scale is related to the actual mesh deformation; we use the min
-            // singular value of the ref->physical Jacobian. In addition, the
-            // time step estimate should be aware of the presence of shocks.
-            const double h_min =
-               Jpr.CalcSingularvalue(dim-1) / (double) H1.GetOrder(0);
-            const double inv_dt = sound_speed / h_min +
-                                  2.5 * visc_coeff / rho / h_min / h_min;
-            if (min_detJ < 0.0)
-            {
-               // This will force repetition of the step with smaller dt.
-               qdata.dt_est = 0.0;
-            }
-            else
-            {
-               if (inv_dt>0.0)
+               else
                {
-                  qdata.dt_est = fmin(qdata.dt_est, cfl*(1.0/inv_dt));
+                  if (inv_dt>0.0)
+                  {
+                     dt_est = fmin(dt_est, cfl*(1.0/inv_dt));
+                  }
                }
-            }
-            // Quadrature data for partial assembly of the force operator.
-            MultABt(stress, Jinv, stressJiT);
-            stressJiT *= ir.IntPoint(q).weight * detJ;
-            for (int vd = 0 ; vd < dim; vd++)
-            {
-               for (int gd = 0; gd < dim; gd++)
+               // Quadrature data for partial assembly of the force operator.
+               MultABt(stress, Jinv, stressJiT);
+               stressJiT *= ir.IntPoint(q).weight * detJ;
+               for (int vd = 0 ; vd < dim; vd++)
                {
-                  qdata.stressJinvT(vd)(z_id*nqp + q, gd) =
-                     stressJiT(vd, gd);
+                  for (int gd = 0; gd < dim; gd++)
+                  {
+                     qdata.stressJinvT(vd)(z_id*nqp + q, gd) =
+                        stressJiT(vd, gd);
+                  }
                }
             }
+            ++z_id;
          }
-         ++z_id;
       }
    }
-   delete [] gamma_b;
-   delete [] rho_b;
-   delete [] e_b;
-   delete [] p_b;
-   delete [] cs_b;
-   delete [] Jpr_b;
+   qdata.dt_est = dt_est;
    timer.sw_qdata.Stop();
    timer.quad_tstep += NE;
 }
@@ -988,7 +1405,7 @@ void QUpdateBody(const int NE, const int e,
                  const double* __restrict__ d_e_quads,
                  const double* __restrict__ d_grad_v_ext,
                  const double* __restrict__ d_Jac0inv,
-                 double *d_dt_est,
+                 double &dt_est,
                  double *d_stressJinvT)
 {
    constexpr int DIM2 = DIM*DIM;
@@ -1068,14 +1485,14 @@ void QUpdateBody(const int NE, const int e,
    if (min_detJ < 0.0)
    {
       // This will force repetition of the step with smaller dt.
-      d_dt_est[eq] = 0.0;
+      dt_est = 0.0;
    }
    else
    {
       if (idt > 0.0)
       {
          const double cfl_inv_dt = cfl / idt;
-         d_dt_est[eq] = fmin(d_dt_est[eq], cfl_inv_dt);
+         dt_est = fmin(dt_est, cfl_inv_dt);
       }
    }
    // Quadrature data for partial assembly of the force operator.
@@ -1199,10 +1616,12 @@ void QKernel(const int NE, const int NQ,
              const Vector &e_quads,
              const Vector &grad_v_ext,
              const DenseTensor &Jac0inv,
+             const double dt_est0,
              Vector &dt_est,
              DenseTensor &stressJinvT)
 {
    constexpr int DIM2 = DIM*DIM;
+   constexpr int NQ1D = DIM == 2 ? Q1D*Q1D : Q1D*Q1D*Q1D;
    const auto d_gamma = gamma_gf.Read();
    const auto d_weights = weights.Read();
    const auto d_Jacobians = Jacobians.Read();
@@ -1210,7 +1629,8 @@ void QKernel(const int NE, const int NQ,
    const auto d_e_quads = e_quads.Read();
    const auto d_grad_v_ext = grad_v_ext.Read();
    const auto d_Jac0inv = Read(Jac0inv.GetMemory(), Jac0inv.TotalSize());
-   auto d_dt_est = dt_est.ReadWrite();
+   // One partial minimum of the time step estimate per element (block).
+   auto d_dt_est = dt_est.Write();
    auto d_stressJinvT = Write(stressJinvT.GetMemory(), stressJinvT.TotalSize());
    if (DIM == 2)
    {
@@ -1225,20 +1645,31 @@ void QKernel(const int NE, const int NQ,
          double Jpi[DIM2];
          double ph_dir[DIM];
          double stressJiT[DIM2];
+         MFEM_SHARED double dt_min[NQ1D];
          MFEM_FOREACH_THREAD(qx,x,Q1D)
          {
             MFEM_FOREACH_THREAD(qy,y,Q1D)
             {
-               QUpdateBody<DIM>(NE, e, NQ, qx + qy * Q1D,
+               const int q = qx + qy * Q1D;
+               double dt_q = dt_est0;
+               QUpdateBody<DIM>(NE, e, NQ, q,
                                 use_viscosity, use_vorticity, h0, h1order, cfl, infinity,
                                 Jinv, stress, sgrad_v, eig_val_data, eig_vec_data,
                                 compr_dir, Jpi, ph_dir, stressJiT,
                                 d_gamma, d_weights, d_Jacobians, d_rho0DetJ0w,
                                 d_e_quads, d_grad_v_ext, d_Jac0inv,
-                                d_dt_est, d_stressJinvT);
+                                dt_q, d_stressJinvT);
+               dt_min[q] = dt_q;
             }
          }
          MFEM_SYNC_THREAD;
+         if (MFEM_THREAD_ID(x) == 0 && MFEM_THREAD_ID(y) == 0)
+         {
+            double dt_e = dt_min[0];
+            for (int q = 1; q < NQ1D; q++) { dt_e = fmin(dt_e, dt_min[q]); }
+            d_dt_est[e] = dt_e;
+         }
+         MFEM_SYNC_THREAD;
       });
    }
    if (DIM == 3)
@@ -1254,27 +1685,48 @@ void QKernel(const int NE, const int NQ,
          double Jpi[DIM2];
          double ph_dir[DIM];
          double stressJiT[DIM2];
+         MFEM_SHARED double dt_min[NQ1D];
          MFEM_FOREACH_THREAD(qx,x,Q1D)
          {
             MFEM_FOREACH_THREAD(qy,y,Q1D)
             {
                MFEM_FOREACH_THREAD(qz,z,Q1D)
                {
-                  QUpdateBody<DIM>(NE, e, NQ, qx + Q1D * (qy + qz * Q1D),
+                  const int q = qx + Q1D * (qy + qz * Q1D);
+                  double dt_q = dt_est0;
+                  QUpdateBody<DIM>(NE, e, NQ, q,
                                    use_viscosity, use_vorticity, h0, h1order, cfl, infinity,
                                    Jinv, stress, sgrad_v, eig_val_data, eig_vec_data,
                                    compr_dir, Jpi, ph_dir, stressJiT,
                                    d_gamma, d_weights, d_Jacobians, d_rho0DetJ0w,
                                    d_e_quads, d_grad_v_ext, d_Jac0inv,
-                                   d_dt_est, d_stressJinvT);
+                                   dt_q, d_stressJinvT);
+                  dt_min[q] = dt_q;
                }
             }
          }
          MFEM_SYNC_THREAD;
+         if (MFEM_THREAD_ID(x) == 0 && MFEM_THREAD_ID(y) == 0 &&
+             MFEM_THREAD_ID(z) == 0)
+         {
+            double dt_e = dt_min[0];
+            for (int q = 1; q < NQ1D; q++) { dt_e = fmin(dt_e, dt_min[q]); }
+            d_dt_est[e] = dt_e;
+         }
+         MFEM_SYNC_THREAD;
       });
    }
 }
 
+void QUpdate::PlaceZoneData(ZoneMemory &mem)
+{
+   mem.Place(q_dt_est, NE);
+   mem.Place(q_e, NE);
+   mem.Place(e_vec, NE);
+   mem.Place(q_dx, NE);
+   mem.Place(q_dv, NE);
+}
+
 void QUpdate::UpdateQuadratureData(const Vector &S, QuadratureData &qdata)
 {
    timer->sw_qdata.Start();
@@ -1293,7 +1745,6 @@ void QUpdate::UpdateQuadratureData(const Vector &S, QuadratureData &qdata)
    e.MakeRef(&L2, *S_p, 2*H1_size);
    q2->SetOutputLayout(QVectorLayout::byVDIM);
    q2->Values(e, q_e);
-   q_dt_est = qdata.dt_est;
    const int id = (dim << 4) | Q1D;
    typedef void (*fQKernel)(const int NE, const int NQ,
                             const bool use_viscosity,
@@ -1304,7 +1755,7 @@ void QUpdate::UpdateQuadratureData(const Vector &S, QuadratureData &qdata)
                             const Array<double> &weights,
                             const Vector &Jacobians, const Vector &rho0DetJ0w,
                             const Vector &e_quads, const Vector &grad_v_ext,
-                            const DenseTensor &Jac0inv,
+                            const DenseTensor &Jac0inv, const double dt_est0,
                             Vector &dt_est, DenseTensor &stressJinvT);
    static std::unordered_map<int, fQKernel> qupdate =
    {
@@ -1316,10 +1767,14 @@ void QUpdate::UpdateQuadratureData(const Vector &S, QuadratureData &qdata)
       mfem::out << "Unknown kernel 0x" << std::hex << id << std::endl;
       MFEM_ABORT("Unknown kernel");
    }
-   qupdate[id](NE, NQ, use_viscosity, use_vorticity, qdata.h0, h1order,
-               cfl, infinity, gamma_gf, ir.GetWeights(), q_dx,
-               qdata.rho0DetJ0w, q_e, q_dv,
-               qdata.Jac0inv, q_dt_est, qdata.stressJinvT);
+   {
+      PerfScope perf(PERF_QKERNEL, NE, QKernelCost(dim, Q1D));
+      qupdate[id](NE, NQ, use_viscosity, use_vorticity, qdata.h0, h1order,
+                  cfl, infinity, gamma_gf, ir.GetWeights(), q_dx,
+                  qdata.rho0DetJ0w, q_e, q_dv,
+                  qdata.Jac0inv, qdata.dt_est, q_dt_est, qdata.stressJinvT);
+   }
+   // Final reduction over the per-element partial minima.
    qdata.dt_est = q_dt_est.Min();
    timer->sw_qdata.Stop();
    timer->quad_tstep += NE;
@@ -1330,7 +1785,36 @@ void LagrangianHydroOperator::AssembleForceMatrix() const
    if (forcemat_is_assembled || p_assembly) { return; }
    Force = 0.0;
    timer.sw_force.Start();
+#if defined(_OPENMP) && defined(MFEM_THREAD_SAFE)
+   // The element matrices are computed by the threads, while their (cheap)
+   // scatter into the shared sparsity pattern is done in zone order, as in
+   // MixedBilinearForm::Assemble().
+   const int h1vdofs_cnt = h1dofs_cnt * dim;
+   Force_el.SetSize(h1vdofs_cnt, l2dofs_cnt, NE);
+   LAGHOS_OMP_FE(parallel)
+   {
+      LAGHOS_TRACE("force_zones");
+      ForceIntegrator fi(qdata);
+      fi.SetIntRule(&ir);
+      IsoparametricTransformation Tr;
+      LAGHOS_OMP_FE(for schedule(static) nowait)
+      for (int e = 0; e < NE; e++)
+      {
+         pmesh->GetElementTransformation(e, &Tr);
+         fi.AssembleElementMatrix2(*L2.GetFE(e), *H1.GetFE(e), Tr, Force_el(e));
+      }
+   }
+   SparseMatrix &F = Force.SpMat();
+   Array<int> h1vdofs, l2vdofs;
+   for (int e = 0; e < NE; e++)
+   {
+      H1.GetElementVDofs(e, h1vdofs);
+      L2.GetElementVDofs(e, l2vdofs);
+      F.AddSubMatrix(h1vdofs, l2vdofs, Force_el(e));
+   }
+#else
    Force.Assemble();
+#endif
    timer.sw_force.Stop();
    forcemat_is_assembled = true;
 }
@@ -1372,23 +1856,28 @@ void RK2AvgSolver::Step(Vector &S, double &t, double &dt)
 
    // -- 1.
    // S is S0.
+   hydrodynamics::TimingData &timer = hydro_oper->GetTimingData();
+   timer.sw_stage.Start();
    hydro_oper->UpdateMesh(S);
    hydro_oper->SolveVelocity(S, dS_dt);
    // V = v0 + 0.5 * dt * dv_dt;
    add(v0, 0.5 * dt, dv_dt, V);
    hydro_oper->SolveEnergy(S, V, dS_dt);
    dx_dt = V;
+   timer.sw_stage.Stop();
 
    // -- 2.
    // S = S0 + 0.5 * dt * dS_dt;
    add(S0, 0.5 * dt, dS_dt, S);
    hydro_oper->ResetQuadratureData();
+   timer.sw_stage.Start();
    hydro_oper->UpdateMesh(S);
    hydro_oper->SolveVelocity(S, dS_dt);
    // V = v0 + 0.5 * dt * dv_dt;
    add(v0, 0.5 * dt, dv_dt, V);
    hydro_oper->SolveEnergy(S, V, dS_dt);
    dx_dt = V;
+   timer.sw_stage.Stop();
 
    // -- 3.
    // S = S0 + dt * dS_dt.
@@ -19,6 +19,7 @@
 
 #include "mfem.hpp"
 #include "laghos_assembly.hpp"
+#include "laghos_halo.hpp"
 
 #ifdef MFEM_USE_MPI
 
@@ -36,23 +37,67 @@ void VisualizeField(socketstream &sock, const char *vishost, int visport,
                     int x = 0, int y = 0, int w = 400, int h = 400,
                     bool vec = false);
 
+// Sum over all ranks of a local count, in 64-bit arithmetic.
+long long GlobalCount(MPI_Comm comm, const long long local);
+
 struct TimingData
 {
    // Total times for all major computations:
    // CG solves (H1 and L2) / force RHS assemblies / quadrature computations.
    StopWatch sw_cgH1, sw_cgL2, sw_force, sw_qdata;
+   // Additional phases of the hierarchical report, see PrintPhaseTimers():
+   // time steps, RK stages, time step estimates, exchanges of the shared dofs
+   // outside of the CG solves (partial assembly), and output.
+   StopWatch sw_step, sw_stage, sw_dt_est, sw_halo, sw_output;
+   // Part of sw_qdata spent in the time step estimates, outside of the stages.
+   double rt_qdata_dt_est;
 
    // Store the number of dofs of the corresponding local CG
-   const HYPRE_Int L2dof;
+   const long long L2dof;
 
    // These accumulate the total processed dofs or quad points:
    // #(CG iterations) for the L2 CG solve.
    // #quads * #(RK sub steps) for the quadrature data computations.
-   HYPRE_Int H1iter, L2iter;
-   HYPRE_Int quad_tstep;
+   // All the counters are 64-bit, independently of the integer type of hypre,
+   // as their global sums overflow 32 bits in large runs.
+   long long H1iter, L2iter;
+   long long quad_tstep;
+
+   // Real times {cgH1, cgL2, force, qdata} accumulated before a restart.
+   double rt_restart[4];
+   // Real times {step, stage, dt_est, halo, output} accumulated before a
+   // restart.
+   double rt_restart_phase[5];
+
+   TimingData(const long long l2d) :
+      rt_qdata_dt_est(0.0), L2dof(l2d), H1iter(0), L2iter(0), quad_tstep(0),
+      rt_restart{0.0, 0.0, 0.0, 0.0},
+      rt_restart_phase{0.0, 0.0, 0.0, 0.0, 0.0} { }
+};
+
+// Global counts of the figures of merit of PrintTimingData(): the L2 dofs times
+// the L2 CG iterations, the quadrature points times the RK stages, the zones,
+// and the dofs of the FOM table (two H1 spaces, L2 and the quadrature points).
+struct FOMCounts
+{
+   long long L2dof_iter, quad_tstep, zones, ndofs;
+};
+
+// Sums the FOM counts of the local timer and NE zones over the ranks of comm,
+// with QPT quadrature points per zone and the given global true dof counts.
+FOMCounts GlobalFOMCounts(MPI_Comm comm, const TimingData &timer,
+                          const long long NE, const int QPT,
+                          const long long H1GTVSize,
+                          const long long L2GTVSize);
 
-   TimingData(const HYPRE_Int l2d) :
-      L2dof(l2d), H1iter(0), L2iter(0), quad_tstep(0) { }
+// Values of the state at the quadrature points of all local zones, used by the
+// in-situ analysis. Point q of zone z has index z*NQ + q, and the vector
+// quantities store dim values per point.
+struct QuadratureFields
+{
+   Vector x, v, rho, e;
+   // Mass of each point, rho0 * det(J0) * weight, and the initial density.
+   Vector mass, rho0;
 };
 
 class QUpdate
@@ -80,7 +125,7 @@ public:
       use_viscosity(visc), use_vorticity(vort), cfl(cfl),
       timer(t), ir(ir), H1(h1), L2(l2),
       H1R(H1.GetElementRestriction(ElementDofOrdering::LEXICOGRAPHIC)),
-      q_dt_est(NE*NQ),
+      q_dt_est(NE),
       q_e(NE*NQ),
       e_vec(NQ*NE*vdim),
       q_dx(NQ*NE*vdim*vdim),
@@ -90,6 +135,8 @@ public:
       gamma_gf(gamma_gf) { }
 
    void UpdateQuadratureData(const Vector &S, QuadratureData &qdata);
+   // Moves the quadrature point arrays into NUMA first-touched memory.
+   void PlaceZoneData(ZoneMemory &mem);
 };
 
 // Given a solutions state (x, v, e), this class performs all necessary
@@ -103,10 +150,10 @@ protected:
    // FE spaces local and global sizes
    const int H1Vsize;
    const int H1TVSize;
-   const HYPRE_Int H1GTVSize;
+   const long long H1GTVSize;
    const int L2Vsize;
    const int L2TVSize;
-   const HYPRE_Int L2GTVSize;
+   const long long L2GTVSize;
    Array<int> block_offsets;
    // Reference to the current mesh configuration.
    mutable ParGridFunction x_gf;
@@ -134,19 +181,37 @@ protected:
    // assembled in each time step and then it is used to compute the final
    // right-hand sides for momentum and specific internal energy.
    mutable MixedBilinearForm Force;
+   // Element force matrices, used when the FA assembly is threaded.
+   mutable DenseTensor Force_el;
    // Same as above, but done through partial assembly.
    ForcePAOperator *ForcePA;
    // Mass matrices done through partial assembly:
    // velocity (coupled H1 assembly) and energy (local L2 assemblies).
    MassPAOperator *VMassPA, *EMassPA;
    OperatorJacobiSmoother *VMassPA_Jprec;
+   // Optional prolongations of H1c and H1 with the node-local shared-memory
+   // exchange, used in the velocity solves and in the force summation.
+   NodeLocalProlongation *H1c_P, *H1_P;
    // Linear solver for energy.
    CGSolver CG_VMass, CG_EMass;
    mutable TimingData timer;
    mutable QUpdate *qupdate;
    mutable Vector X, B, one, rhs, e_rhs;
+   // Scratch data of the batched density projection.
+   mutable Vector dens_rhs, dens_x_vec, dens_J, dens_rho_vec, dens_tri;
+   // Scratch data of the fused energy diagnostics kernel.
+   mutable Vector diag_e_vec, diag_e_qp, diag_v_vec, diag_v_qp, diag_part;
    mutable ParGridFunction rhs_c_gf, dvc_gf;
    mutable Array<int> c_tdofs[3];
+   // Nonblocking reduction of the time step estimate. The local dt_est is
+   // bundled with other scalar diagnostics in one message: the first entry is
+   // reduced with MPI_MIN, the remaining ones with MPI_SUM.
+   static constexpr int dt_red_max_diags = 4;
+   mutable double dt_red_loc[1 + dt_red_max_diags];
+   mutable double dt_red_glob[1 + dt_red_max_diags];
+   mutable int dt_red_size;
+   mutable MPI_Request dt_red_req;
+   MPI_Op dt_red_op;
 
    virtual void ComputeMaterialProperties(int nvalues, const double gamma[],
                                           const double rho[], const double e[],
@@ -187,21 +252,56 @@ public:
    void SolveEnergy(const Vector &S, const Vector &v, Vector &dS_dt) const;
    void UpdateMesh(const Vector &S) const;
 
+   // Exchanges the shared velocity dofs of ranks on the same node through
+   // shared memory in the velocity solves and in the summation of the force
+   // right-hand side (partial assembly, host only).
+   void UseNodeLocalExchange();
+   // Moves the quadrature data and the scratch arrays of the partial assembly
+   // kernels into NUMA first-touched memory, see ZoneMemory.
+   void PlaceZoneData(ZoneMemory &mem);
+
    // Calls UpdateQuadratureData to compute the new qdata.dt_estimate.
    double GetTimeStepEstimate(const Vector &S) const;
+   // Split version of the above: computes the local dt estimate and posts its
+   // global reduction together with ndiag local values that are summed over
+   // all ranks. The result is obtained with FinishTimeStepEstimate(), which
+   // also returns the reduced diagnostics in diag.
+   void StartTimeStepEstimate(const Vector &S, const double *diag = nullptr,
+                              const int ndiag = 0) const;
+   double FinishTimeStepEstimate(double *diag = nullptr) const;
    void ResetTimeStepEstimate() const;
    void ResetQuadratureData() const { qdata_is_current = false; }
 
    // The density values, which are stored only at some quadrature points,
    // are projected as a ParGridFunction.
    void ComputeDensity(ParGridFunction &rho) const;
-   double InternalEnergy(const ParGridFunction &e) const;
-   double KineticEnergy(const ParGridFunction &v) const;
+
+   // Fused energy diagnostics, computed in a single pass over the elements:
+   // diag = {internal energy, kinetic energy, |e|^2}. The local version does
+   // no communication, so its values can be bundled with other reductions.
+   void LocalEnergyDiagnostics(const ParGridFunction &e,
+                               const ParGridFunction &v, double diag[3]) const;
+   void EnergyDiagnostics(const ParGridFunction &e, const ParGridFunction &v,
+                          double diag[3]) const;
+
+   // Evaluates the state S at the quadrature points of all local zones. The
+   // density is obtained from the pointwise mass conservation.
+   void ComputeQuadratureFields(const Vector &S, QuadratureFields &qf) const;
 
    int GetH1VSize() const { return H1.GetVSize(); }
+   // Checkpoint/restart access to the state that is not stored in S.
+   double GetInitialMeshSize() const { return qdata.h0; }
+   void SetInitialMeshSize(const double h0) { qdata.h0 = h0; }
+   TimingData &GetTimingData() const { return timer; }
    const Array<int> &GetBlockOffsets() const { return block_offsets; }
 
    void PrintTimingData(bool IamRoot, int steps, const bool fom) const;
+   // Prints the tree of phases: time step > RK stage > quadrature data, force,
+   // CG (H1), CG (L2), halo exchange; time step > output. For each phase, the
+   // minimum, average and maximum time over the ranks are given, as well as
+   // the imbalance max/avg. A large imbalance of a phase whose parent is
+   // balanced shows that its ranks wait for each other.
+   void PrintPhaseTimers(bool IamRoot) const;
 };
 
 // TaylorCoefficient used in the 2D Taylor-Green problem.
@@ -0,0 +1,144 @@
+// Copyright (c) 2017, Lawrence Livermore National Security, LLC. Produced at
+// the Lawrence Livermore National Laboratory. LLNL-CODE-734707. All Rights
+// reserved. See files LICENSE and NOTICE for details.
+//
+// This file is part of CEED, a collection of benchmarks, miniapps, software
+// libraries and APIs for efficient high-order finite element and spectral
+// element discretizations for exascale applications. For more information and
+// source code availability see http://github.com/ceed.
+//
+// The CEED research is supported by the Exascale Computing Project 17-SC-20-SC,
+// a collaborative effort of two U.S. Department of Energy organizations (Office
+// of Science and the National Nuclear Security Administration) responsible for
+// the planning and preparation of a capable exascale ecosystem, including
+// software, applications, hardware, advanced system engineering and early
+// testbed platforms, in support of the nation's exascale computing imperative.
+
+#include "laghos_trace.hpp"
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef MFEM_USE_MPI
+
+namespace mfem
+{
+
+namespace hydrodynamics
+{
+
+struct TraceEvent
+{
+   const char *name;
+   double ts, dur; // microseconds
+   int tid;
+};
+
+static bool trace_on = false;
+static MPI_Comm trace_comm = MPI_COMM_NULL;
+static std::chrono::steady_clock::time_point trace_origin;
+static std::vector<TraceEvent> trace_events;
+static std::atomic<unsigned long long> trace_count(0);
+static std::atomic<int> trace_threads(0);
+
+static double TraceNow()
+{
+   const std::chrono::duration<double, std::micro> t =
+      std::chrono::steady_clock::now() - trace_origin;
+   return t.count();
+}
+
+// Small thread ids in the order of the first event of each thread.
+static int TraceThreadId()
+{
+   static thread_local int tid = trace_threads++;
+   return tid;
+}
+
+void TraceInit(MPI_Comm comm, const size_t max_events)
+{
+   MFEM_VERIFY(max_events > 0, "The trace needs room for at least 1 event.");
+   trace_comm = comm;
+   trace_events.resize(max_events);
+   trace_count = 0;
+   // The ranks start their clocks together, to align their timelines.
+   MPI_Barrier(comm);
+   trace_origin = std::chrono::steady_clock::now();
+   trace_on = true;
+}
+
+TraceScope::TraceScope(const char *name)
+   : name(name), t0(trace_on ? TraceNow() : 0.0) { }
+
+TraceScope::~TraceScope()
+{
+   if (!trace_on) { return; }
+   TraceEvent ev;
+   ev.name = name;
+   ev.ts = t0;
+   ev.dur = TraceNow() - t0;
+   ev.tid = TraceThreadId();
+   const unsigned long long i = trace_count++;
+   trace_events[i % trace_events.size()] = ev;
+}
+
+void TraceWrite(const char *fname)
+{
+   if (!trace_on) { return; }
+   trace_on = false;
+   int myid, nranks;
+   MPI_Comm_rank(trace_comm, &myid);
+   MPI_Comm_size(trace_comm, &nranks);
+
+   // The events of this rank, oldest first.
+   const unsigned long long count = trace_count, cap = trace_events.size();
+   const unsigned long long n = (count < cap) ? count : cap;
+   std::ostringstream os;
+   os.precision(15);
+   os << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << myid
+      << ",\"args\":{\"name\":\"rank " << myid << "\"}}";
+   for (unsigned long long k = count - n; k < count; k++)
+   {
+      const TraceEvent &ev = trace_events[k % cap];
+      os << ",\n{\"name\":\"" << ev.name << "\",\"ph\":\"X\",\"pid\":" << myid
+         << ",\"tid\":" << ev.tid << ",\"ts\":" << ev.ts << ",\"dur\":"
+         << ev.dur << "}";
+   }
+   const std::string events = os.str();
+
+   const int size = static_cast<int>(events.size());
+   std::vector<int> sizes(nranks), displs(nranks);
+   MPI_Gather(&size, 1, MPI_INT, sizes.data(), 1, MPI_INT, 0, trace_comm);
+   long long total = 0;
+   for (int r = 0; r < nranks; r++)
+   {
+      displs[r] = static_cast<int>(total);
+      total += sizes[r];
+   }
+   MFEM_VERIFY(myid != 0 || total <= INT_MAX,
+               "The trace is too large, reduce the number of events.");
+   std::string all(myid == 0 ? total : 0, '\0');
+   MPI_Gatherv(const_cast<char *>(events.data()), size, MPI_CHAR, &all[0],
+               sizes.data(), displs.data(), MPI_CHAR, 0, trace_comm);
+   if (myid != 0) { return; }
+
+   std::ofstream ofs(fname);
+   MFEM_VERIFY(ofs, "Cannot open the trace file " << fname);
+   ofs << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+   for (int r = 0; r < nranks; r++)
+   {
+      if (r > 0) { ofs << ",\n"; }
+      ofs.write(all.data() + displs[r], sizes[r]);
+   }
+   ofs << "\n]}\n";
+}
+
+} // namespace hydrodynamics
+
+} // namespace mfem
+
+#endif // MFEM_USE_MPI
@@ -0,0 +1,65 @@
+// Copyright (c) 2017, Lawrence Livermore National Security, LLC. Produced at
+// the Lawrence Livermore National Laboratory. LLNL-CODE-734707. All Rights
+// reserved. See files LICENSE and NOTICE for details.
+//
+// This file is part of CEED, a collection of benchmarks, miniapps, software
+// libraries and APIs for efficient high-order finite element and spectral
+// element discretizations for exascale applications. For more information and
+// source code availability see http://github.com/ceed.
+//
+// The CEED research is supported by the Exascale Computing Project 17-SC-20-SC,
+// a collaborative effort of two U.S. Department of Energy organizations (Office
+// of Science and the National Nuclear Security Administration) responsible for
+// the planning and preparation of a capable exascale ecosystem, including
+// software, applications, hardware, advanced system engineering and early
+// testbed platforms, in support of the nation's exascale computing imperative.
+
+#ifndef MFEM_LAGHOS_TRACE
+#define MFEM_LAGHOS_TRACE
+
+#include "mfem.hpp"
+#include <cstddef>
+
+#ifdef MFEM_USE_MPI
+
+namespace mfem
+{
+
+namespace hydrodynamics
+{
+
+// Timeline of the main phases of each rank and thread, written in the Chrome
+// trace-event JSON format, which can be opened in chrome://tracing or in the
+// Perfetto UI. The events of a rank are kept in a ring buffer of a bounded
+// number of events, so long runs keep the most recent ones. Recording is off
+// until TraceInit() is called, and then costs two clock readings per event.
+void TraceInit(MPI_Comm comm, const size_t max_events);
+// Gathers the events of all ranks and writes them to fname on rank 0, with
+// one process per rank. Collective on the communicator of TraceInit().
+void TraceWrite(const char *fname);
+
+// Records the lifetime of the object as a complete event. The name must be a
+// string literal, or otherwise outlive TraceWrite().
+class TraceScope
+{
+private:
+   const char *name;
+   double t0;
+public:
+   explicit TraceScope(const char *name);
+   ~TraceScope();
+};
+
+} // namespace hydrodynamics
+
+} // namespace mfem
+
+#define LAGHOS_TRACE_CAT2(a, b) a##b
+#define LAGHOS_TRACE_CAT(a, b) LAGHOS_TRACE_CAT2(a, b)
+// Traces the rest of the enclosing scope under the given name.
+#define LAGHOS_TRACE(name) mfem::hydrodynamics::TraceScope \
+   LAGHOS_TRACE_CAT(laghos_trace_, __LINE__)(name)
+
+#endif // MFEM_USE_MPI
+
+#endif // MFEM_LAGHOS_TRACE
@@ -21,6 +21,22 @@
 #include "general/forall.hpp"
 #include "linalg/dtensor.hpp"
 
+// Host-side loops over the zones are threaded with OpenMP when it is enabled.
+// Loops that evaluate MFEM element objects (finite elements, transformations,
+// integrators) use LAGHOS_OMP_FE, which additionally requires MFEM to be built
+// with MFEM_THREAD_SAFE, i.e., without shared scratch data in these objects.
+#define LAGHOS_PRAGMA(...) _Pragma(#__VA_ARGS__)
+#ifdef _OPENMP
+#define LAGHOS_OMP(...) LAGHOS_PRAGMA(omp __VA_ARGS__)
+#else
+#define LAGHOS_OMP(...)
+#endif
+#if defined(_OPENMP) && defined(MFEM_THREAD_SAFE)
+#define LAGHOS_OMP_FE(...) LAGHOS_PRAGMA(omp __VA_ARGS__)
+#else
+#define LAGHOS_OMP_FE(...)
+#endif
+
 namespace mfem
 {
 
@@ -253,15 +253,20 @@ LagrangianHydroOperator::LagrangianHydroOperator(const int size,
       // Standard local assembly and inversion for energy mass matrices.
       // 'Me' is used in the computation of the internal energy
       // which is used twice: once at the start and once at the end of the run.
-      MassIntegrator mi(rho0_coeff, &ir);
-      for (int e = 0; e < NE; e++)
+      LAGHOS_OMP_FE(parallel)
       {
-         DenseMatrixInverse inv(&Me(e));
-         const FiniteElement &fe = *L2.GetFE(e);
-         ElementTransformation &Tr = *L2.GetElementTransformation(e);
-         mi.AssembleElementMatrix(fe, Tr, Me(e));
-         inv.Factor();
-         inv.GetInverseMatrix(Me_inv(e));
+         MassIntegrator mi(rho0_coeff, &ir);
+         IsoparametricTransformation Tr;
+         LAGHOS_OMP_FE(for schedule(static))
+         for (int e = 0; e < NE; e++)
+         {
+            DenseMatrixInverse inv(&Me(e));
+            const FiniteElement &fe = *L2.GetFE(e);
+            mesh->GetElementTransformation(e, &Tr);
+            mi.AssembleElementMatrix(fe, Tr, Me(e));
+            inv.Factor();
+            inv.GetInverseMatrix(Me_inv(e));
+         }
       }
       // Standard assembly for the velocity mass matrix.
       VectorMassIntegrator *vmi = new VectorMassIntegrator(rho0_coeff, &ir);
@@ -277,22 +282,39 @@ LagrangianHydroOperator::LagrangianHydroOperator(const int size,
    else
    {
       const int NQ = ir.GetNPoints();
-      Vector rho_vals(NQ);
-      for (int e = 0; e < NE; e++)
+      // Same rule as in Mesh::GetElementVolume(), fetched before the threaded
+      // loop because IntRules.Get() may create it.
+      const IntegrationRule &vol_ir =
+         IntRules.Get(mesh->GetElementBaseGeometry(0),
+                      H1.GetElementTransformation(0)->OrderJ());
+      LAGHOS_OMP_FE(parallel reduction(+:vol))
       {
-         rho0_gf.GetValues(e, ir, rho_vals);
-         ElementTransformation &Tr = *H1.GetElementTransformation(e);
-         for (int q = 0; q < NQ; q++)
+         Vector rho_vals(NQ);
+         IsoparametricTransformation Tr;
+         LAGHOS_OMP_FE(for schedule(static))
+         for (int e = 0; e < NE; e++)
          {
-            const IntegrationPoint &ip = ir.IntPoint(q);
-            Tr.SetIntPoint(&ip);
-            DenseMatrixInverse Jinv(Tr.Jacobian());
-            Jinv.GetInverseMatrix(qdata.Jac0inv(e*NQ + q));
-            const double rho0DetJ0 = Tr.Weight() * rho_vals(q);
-            qdata.rho0DetJ0w(e*NQ + q) = rho0DetJ0 * ir.IntPoint(q).weight;
+            mesh->GetElementTransformation(e, &Tr);
+            rho0_gf.GetValues(Tr, ir, rho_vals);
+            for (int q = 0; q < NQ; q++)
+            {
+               const IntegrationPoint &ip = ir.IntPoint(q);
+               Tr.SetIntPoint(&ip);
+               DenseMatrixInverse Jinv(Tr.Jacobian());
+               Jinv.GetInverseMatrix(qdata.Jac0inv(e*NQ + q));
+               const double rho0DetJ0 = Tr.Weight() * rho_vals(q);
+               qdata.rho0DetJ0w(e*NQ + q) = rho0DetJ0 * ir.IntPoint(q).weight;
+            }
+            double vol_e = 0.0;
+            for (int q = 0; q < vol_ir.GetNPoints(); q++)
+            {
+               const IntegrationPoint &ip = vol_ir.IntPoint(q);
+               Tr.SetIntPoint(&ip);
+               vol_e += ip.weight * Tr.Weight();
+            }
+            vol += vol_e;
          }
       }
-      for (int e = 0; e < NE; e++) { vol += mesh->GetElementVolume(e); }
    }
 
    switch (mesh->GetElementBaseGeometry(0))
@@ -458,7 +480,6 @@ void LagrangianHydroOperator::SolveEnergy(const Vector &S, const Vector &v,
       e_source->Assemble();
    }
 
-   Array<int> l2dofs;
    if (p_assembly)
    {
       timer.sw_force.Start();
@@ -480,17 +501,24 @@ void LagrangianHydroOperator::SolveEnergy(const Vector &S, const Vector &v,
       Force.MultTranspose(v, e_rhs);
       timer.sw_force.Stop();
       if (e_source) { e_rhs += *e_source; }
-      Vector loc_rhs(l2dofs_cnt), loc_de(l2dofs_cnt);
-      for (int e = 0; e < NE; e++)
+      e_rhs.HostRead();
+      de.HostReadWrite();
+      timer.sw_cgL2.Start();
+      LAGHOS_OMP(parallel)
       {
-         L2.GetElementDofs(e, l2dofs);
-         e_rhs.GetSubVector(l2dofs, loc_rhs);
-         timer.sw_cgL2.Start();
-         Me_inv(e).Mult(loc_rhs, loc_de);
-         timer.sw_cgL2.Stop();
-         timer.L2iter += 1;
-         de.SetSubVector(l2dofs, loc_de);
+         Array<int> l2dofs;
+         Vector loc_rhs(l2dofs_cnt), loc_de(l2dofs_cnt);
+         LAGHOS_OMP(for schedule(static))
+         for (int e = 0; e < NE; e++)
+         {
+            L2.GetElementDofs(e, l2dofs);
+            e_rhs.GetSubVector(l2dofs, loc_rhs);
+            Me_inv(e).Mult(loc_rhs, loc_de);
+            de.SetSubVector(l2dofs, loc_de);
+         }
       }
+      timer.sw_cgL2.Stop();
+      timer.L2iter += NE;
    }
    delete e_source;
 }
@@ -517,23 +545,28 @@ void LagrangianHydroOperator::ResetTimeStepEstimate() const
 void LagrangianHydroOperator::ComputeDensity(GridFunction &rho) const
 {
    rho.SetSpace(&L2);
-   DenseMatrix Mrho(l2dofs_cnt);
-   Vector rhs(l2dofs_cnt), rho_z(l2dofs_cnt);
-   Array<int> dofs(l2dofs_cnt);
-   DenseMatrixInverse inv(&Mrho);
-   MassIntegrator mi(&ir);
-   DensityIntegrator di(qdata);
-   di.SetIntRule(&ir);
-   for (int e = 0; e < NE; e++)
+   LAGHOS_OMP_FE(parallel)
    {
-      const FiniteElement &fe = *L2.GetFE(e);
-      ElementTransformation &eltr = *L2.GetElementTransformation(e);
-      di.AssembleRHSElementVect(fe, eltr, rhs);
-      mi.AssembleElementMatrix(fe, eltr, Mrho);
-      inv.Factor();
-      inv.Mult(rhs, rho_z);
-      L2.GetElementDofs(e, dofs);
-      rho.SetSubVector(dofs, rho_z);
+      DenseMatrix Mrho(l2dofs_cnt);
+      Vector rhs(l2dofs_cnt), rho_z(l2dofs_cnt);
+      Array<int> dofs(l2dofs_cnt);
+      DenseMatrixInverse inv(&Mrho);
+      MassIntegrator mi(&ir);
+      DensityIntegrator di(qdata);
+      di.SetIntRule(&ir);
+      IsoparametricTransformation eltr;
+      LAGHOS_OMP_FE(for schedule(static))
+      for (int e = 0; e < NE; e++)
+      {
+         const FiniteElement &fe = *L2.GetFE(e);
+         mesh->GetElementTransformation(e, &eltr);
+         di.AssembleRHSElementVect(fe, eltr, rhs);
+         mi.AssembleElementMatrix(fe, eltr, Mrho);
+         inv.Factor();
+         inv.Mult(rhs, rho_z);
+         L2.GetElementDofs(e, dofs);
+         rho.SetSubVector(dofs, rho_z);
+      }
    }
 }
 
@@ -543,16 +576,25 @@ double LagrangianHydroOperator::InternalEnergy(const GridFunction &gf) const
    // This should be turned into a kernel so that it could be displayed in pa
    if (!p_assembly)
    {
-      Vector one(l2dofs_cnt), loc_e(l2dofs_cnt);
-      one = 1.0;
-      Array<int> l2dofs;
-      double loc_ie = 0.0;
-      for (int e = 0; e < NE; e++)
+      // The per-element contributions are summed in zone order, so that the
+      // result does not depend on the number of threads.
+      Vector ie_e(NE);
+      gf.HostRead();
+      LAGHOS_OMP(parallel)
       {
-         L2.GetElementDofs(e, l2dofs);
-         gf.GetSubVector(l2dofs, loc_e);
-         loc_ie += Me(e).InnerProduct(loc_e, one);
+         Vector one(l2dofs_cnt), loc_e(l2dofs_cnt);
+         one = 1.0;
+         Array<int> l2dofs;
+         LAGHOS_OMP(for schedule(static))
+         for (int e = 0; e < NE; e++)
+         {
+            L2.GetElementDofs(e, l2dofs);
+            gf.GetSubVector(l2dofs, loc_e);
+            ie_e(e) = Me(e).InnerProduct(loc_e, one);
+         }
       }
+      double loc_ie = 0.0;
+      for (int e = 0; e < NE; e++) { loc_ie += ie_e(e); }
       glob_ie = loc_ie;
    }
    return glob_ie;
@@ -674,147 +716,146 @@ void LagrangianHydroOperator::UpdateQuadratureData(const Vector &S) const
    x.MakeRef(&H1, *sptr, 0);
    v.MakeRef(&H1, *sptr, H1.GetVSize());
    e.MakeRef(&L2, *sptr, 2*H1.GetVSize());
-   Vector e_vals, e_loc(l2dofs_cnt), vector_vals(h1dofs_cnt * dim);
-   DenseMatrix Jpi(dim), sgrad_v(dim), Jinv(dim), stress(dim), stressJiT(dim),
-               vecvalMat(vector_vals.GetData(), h1dofs_cnt, dim);
-   DenseTensor grad_v_ref(dim, dim, nqp);
-   Array<int> L2dofs, H1dofs;
    // Batched computations are needed, because hydrodynamic codes usually
    // involve expensive computations of material properties. Although this
    // miniapp uses simple EOS equations, we still want to represent the batched
-   // cycle structure.
-   int nzones_batch = 3;
-   const int nbatches =  NE / nzones_batch + 1; // +1 for the remainder.
-   int nqp_batch = nqp * nzones_batch;
-   double *gamma_b = new double[nqp_batch],
-   *rho_b = new double[nqp_batch],
-   *e_b   = new double[nqp_batch],
-   *p_b   = new double[nqp_batch],
-   *cs_b  = new double[nqp_batch];
-   // Jacobians of reference->physical transformations for all quadrature points
-   // in the batch.
-   DenseTensor *Jpr_b = new DenseTensor[nzones_batch];
-   for (int b = 0; b < nbatches; b++)
+   // cycle structure. The batches are distributed among the OpenMP threads.
+   const int nzones_batch_max = 3;
+   const int nbatches = (NE + nzones_batch_max - 1) / nzones_batch_max;
+   double dt_est = qdata.dt_est;
+   LAGHOS_OMP_FE(parallel reduction(min:dt_est))
    {
-      int z_id = b * nzones_batch; // Global index over zones.
-      // The last batch might not be full.
-      if (z_id == NE) { break; }
-      else if (z_id + nzones_batch > NE)
-      {
-         nzones_batch = NE - z_id;
-         nqp_batch    = nqp * nzones_batch;
-      }
-      double min_detJ = std::numeric_limits<double>::infinity();
-      for (int z = 0; z < nzones_batch; z++)
-      {
-         ElementTransformation *T = H1.GetElementTransformation(z_id);
-         Jpr_b[z].SetSize(dim, dim, nqp);
-         e.GetValues(z_id, ir, e_vals);
-         for (int q = 0; q < nqp; q++)
-         {
-            const IntegrationPoint &ip = ir.IntPoint(q);
-            T->SetIntPoint(&ip);
-            Jpr_b[z](q) = T->Jacobian();
-            const double detJ = Jpr_b[z](q).Det();
-            min_detJ = fmin(min_detJ, detJ);
-            const int idx = z * nqp + q;
-            // Assuming piecewise constant gamma that moves with the mesh.
-            gamma_b[idx] = gamma_gf(z_id);
-            rho_b[idx] = qdata.rho0DetJ0w(z_id*nqp + q) / detJ / ip.weight;
-            e_b[idx] = fmax(0.0, e_vals(q));
-         }
-         ++z_id;
-      }
-      // Batched computation of material properties.
-      ComputeMaterialProperties(nqp_batch, gamma_b, rho_b, e_b, p_b, cs_b);
-      z_id -= nzones_batch;
-      for (int z = 0; z < nzones_batch; z++)
+      Vector e_vals;
+      DenseMatrix Jpi(dim), sgrad_v(dim), Jinv(dim);
+      DenseMatrix stress(dim), stressJiT(dim);
+      IsoparametricTransformation T;
+      const int nqp_batch_max = nqp * nzones_batch_max;
+      Vector gamma_b(nqp_batch_max), rho_b(nqp_batch_max), e_b(nqp_batch_max),
+             p_b(nqp_batch_max), cs_b(nqp_batch_max);
+      // Jacobians of reference->physical transformations for all quadrature
+      // points in the batch.
+      DenseTensor Jpr_b[nzones_batch_max];
+      LAGHOS_OMP_FE(for schedule(static))
+      for (int b = 0; b < nbatches; b++)
       {
-         ElementTransformation *T = H1.GetElementTransformation(z_id);
-         for (int q = 0; q < nqp; q++)
+         int z_id = b * nzones_batch_max; // Global index over zones.
+         // The last batch might not be full.
+         const int nzones_batch = std::min(nzones_batch_max, NE - z_id);
+         const int nqp_batch = nqp * nzones_batch;
+         double min_detJ = std::numeric_limits<double>::infinity();
+         for (int z = 0; z < nzones_batch; z++)
          {
-            const IntegrationPoint &ip = ir.IntPoint(q);
-            T->SetIntPoint(&ip);
-            // Note that the Jacobian was already computed above. We've chosen
-            // not to store the Jacobians for all batched quadrature points.
-            const DenseMatrix &Jpr = Jpr_b[z](q);
-            CalcInverse(Jpr, Jinv);
-            const double detJ = Jpr.Det(), rho = rho_b[z*nqp + q],
-                         p = p_b[z*nqp + q], sound_speed = cs_b[z*nqp + q];
-            stress = 0.0;
-            for (int d = 0; d < dim; d++) { stress(d, d) = -p; }
-            double visc_coeff = 0.0;
-            if (use_viscosity)
+            mesh->GetElementTransformation(z_id, &T);
+            Jpr_b[z].SetSize(dim, dim, nqp);
+            e.GetValues(T, ir, e_vals);
+            for (int q = 0; q < nqp; q++)
             {
-               // Compression-based length scale at the point. The first
-               // eigenvector of the symmetric velocity gradient gives the
-               // direction of maximal compression. This is used to define the
-               // relative change of the initial length scale.
-               v.GetVectorGradient(*T, sgrad_v);
-               sgrad_v.Symmetrize();
-               double eig_val_data[3], eig_vec_data[9];
-               eig_val_data[0] = sgrad_v(0, 0);
-               eig_vec_data[0] = 1.;
-               Vector compr_dir(eig_vec_data, dim);
-               // Computes the initial->physical transformation Jacobian.
-               mfem::Mult(Jpr, qdata.Jac0inv(z_id*nqp + q), Jpi);
-               Vector ph_dir(dim); Jpi.Mult(compr_dir, ph_dir);
-               // Change of the initial mesh size in the compression direction.
-               const double h = qdata.h0 * ph_dir.Norml2() /
-                                compr_dir.Norml2();
-               // Measure of maximal compression.
-               const double mu = eig_val_data[0];
-               visc_coeff = 2.0 * rho * h * h * fabs(mu);
-               // The following represents a "smooth" version of the statement
-               // "if (mu < 0) visc_coeff += 0.5 rho h sound_speed".  Note that
-               // eps must be scaled appropriately if a different unit system is
-               // being used.
-               const double eps = 1e-12;
-               visc_coeff += 0.5 * rho * h * sound_speed *
-                             (1.0 - smooth_step_01(mu - 2.0 * eps, eps));
-               stress.Add(visc_coeff, sgrad_v);
+               const IntegrationPoint &ip = ir.IntPoint(q);
+               T.SetIntPoint(&ip);
+               Jpr_b[z](q) = T.Jacobian();
+               const double detJ = Jpr_b[z](q).Det();
+               min_detJ = fmin(min_detJ, detJ);
+               const int idx = z * nqp + q;
+               // Assuming piecewise constant gamma that moves with the mesh.
+               gamma_b(idx) = gamma_gf(z_id);
+               rho_b(idx) = qdata.rho0DetJ0w(z_id*nqp + q) / detJ / ip.weight;
+               e_b(idx) = fmax(0.0, e_vals(q));
             }
-            // Time step estimate at the point. Here the more relevant length
-            // scale is related to the actual mesh deformation; we use the min
-            // singular value of the ref->physical Jacobian. In addition, the
-            // time step estimate should be aware of the presence of shocks.
-            const double h_min =
-               Jpr.CalcSingularvalue(dim-1) / (double) H1.GetOrder(0);
-            const double inv_dt = sound_speed / h_min +
-                                  2.5 * visc_coeff / rho / h_min / h_min;
-            if (min_detJ < 0.0)
-            {
-               // This will force repetition of the step with smaller dt.
-               qdata.dt_est = 0.0;
-            }
-            else
+            ++z_id;
+         }
+         // Batched computation of material properties.
+         ComputeMaterialProperties(nqp_batch, gamma_b.GetData(),
+                                   rho_b.GetData(), e_b.GetData(),
+                                   p_b.GetData(), cs_b.GetData());
+         z_id -= nzones_batch;
+         for (int z = 0; z < nzones_batch; z++)
+         {
+            mesh->GetElementTransformation(z_id, &T);
+            for (int q = 0; q < nqp; q++)
             {
-               if (inv_dt>0.0)
+               const IntegrationPoint &ip = ir.IntPoint(q);
+               T.SetIntPoint(&ip);
+               // Note that the Jacobian was already computed above. We've
+               // chosen not to store the Jacobians for all batched quadrature
+               // points.
+               const DenseMatrix &Jpr = Jpr_b[z](q);
+               CalcInverse(Jpr, Jinv);
+               const double detJ = Jpr.Det(), rho = rho_b(z*nqp + q),
+                            p = p_b(z*nqp + q), sound_speed = cs_b(z*nqp + q);
+               stress = 0.0;
+               for (int d = 0; d < dim; d++) { stress(d, d) = -p; }
+               double visc_coeff = 0.0;
+               if (use_viscosity)
                {
-                  qdata.dt_est = fmin(qdata.dt_est, cfl*(1.0/inv_dt));
+                  // Compression-based length scale at the point. The first
+                  // eigenvector of the symmetric velocity gradient gives the
+                  // direction of maximal compression. This is used to define
+                  // the relative change of the initial length scale.
+                  v.GetVectorGradient(T, sgrad_v);
+                  sgrad_v.Symmetrize();
+                  double eig_val_data[3], eig_vec_data[9];
+                  eig_val_data[0] = sgrad_v(0, 0);
+                  eig_vec_data[0] = 1.;
+                  Vector compr_dir(eig_vec_data, dim);
+                  // Computes the initial->physical transformation Jacobian.
+                  mfem::Mult(Jpr, qdata.Jac0inv(z_id*nqp + q), Jpi);
+                  Vector ph_dir(dim); Jpi.Mult(compr_dir, ph_dir);
+                  // Change of the initial mesh size in the compression
+                  // direction.
+                  const double h = qdata.h0 * ph_dir.Norml2() /
+                                   compr_dir.Norml2();
+                  // Measure of maximal compression.
+                  const double mu = eig_val_data[0];
+                  visc_coeff = 2.0 * rho * h * h * fabs(mu);
+                  // The following represents a "smooth" version of the
+                  // statement "if (mu < 0) visc_coeff += 0.5 rho h sound_speed".
+                  // Note that eps must be scaled appropriately if a different
+                  // unit system is being used.
+                  const double eps = 1e-12;
+                  visc_coeff += 0.5 * rho * h * sound_speed *
+                                (1.0 - smooth_step_01(mu - 2.0 * eps, eps));
+                  stress.Add(visc_coeff, sgrad_v);
                }
-            }
-            // Quadrature data for partial assembly of the force operator.
-            MultABt(stress, Jinv, stressJiT);
-            stressJiT *= ir.IntPoint(q).weight * detJ;
-            for (int vd = 0 ; vd < dim; vd++)
-            {
-               for (int gd = 0; gd < dim; gd++)
+               // Time step estimate at the point. Here the more relevant
+               // length scale is related to the actual mesh deformation; we use
+               // the min singular value of the ref->physical Jacobian. In
+               // addition, the time step estimate should be aware of the
+               // presence of shocks.
+               const double h_min =
+                  Jpr.CalcSingularvalue(dim-1) / (double) H1.GetOrder(0);
+               const double inv_dt = sound_speed / h_min +
+                                     2.5 * visc_coeff / rho / h_min / h_min;
+               if (min_detJ < 0.0)
+               {
+                  // This will force repetition of the step with smaller dt.
+                  dt_est = 0.0;
+               }
+               else
                {
-                  qdata.stressJinvT(vd)(z_id*nqp + q, gd) =
-                     stressJiT(vd, gd);
+                  if (inv_dt>0.0)
+                  {
+                     dt_est = fmin(dt_est, cfl*(1.0/inv_dt));
+                  }
+               }
+               // Quadrature data for partial assembly of the force operator.
+               MultABt(stress, Jinv, stressJiT);
+               stressJiT *= ir.IntPoint(q).weight * detJ;
+               for (int vd = 0 ; vd < dim; vd++)
+               {
+                  for (int gd = 0; gd < dim; gd++)
+                  {
+                     qdata.stressJinvT(vd)(z_id*nqp + q, gd) =
+                        stressJiT(vd, gd);
+                  }
                }
             }
+            ++z_id;
          }
-         ++z_id;
       }
    }
-   delete [] gamma_b;
-   delete [] rho_b;
-   delete [] e_b;
-   delete [] p_b;
-   delete [] cs_b;
-   delete [] Jpr_b;
+   // The min-reduction does not depend on the order of the zones, hence the
+   // estimate is independent of the number of threads.
+   qdata.dt_est = dt_est;
    timer.sw_qdata.Stop();
    timer.quad_tstep += NE;
 }
@@ -843,7 +884,7 @@ void QUpdateBody(const int NE, const int e,
                  const double* __restrict__ d_e_quads,
                  const double* __restrict__ d_grad_v_ext,
                  const double* __restrict__ d_Jac0inv,
-                 double *d_dt_est,
+                 double &dt_est,
                  double *d_stressJinvT)
 {
    constexpr int DIM2 = DIM*DIM;
@@ -913,14 +954,14 @@ void QUpdateBody(const int NE, const int e,
    if (min_detJ < 0.0)
    {
       // This will force repetition of the step with smaller dt.
-      d_dt_est[eq] = 0.0;
+      dt_est = 0.0;
    }
    else
    {
       if (idt > 0.0)
       {
          const double cfl_inv_dt = cfl / idt;
-         d_dt_est[eq] = fmin(d_dt_est[eq], cfl_inv_dt);
+         dt_est = fmin(dt_est, cfl_inv_dt);
       }
    }
    // Quadrature data for partial assembly of the force operator.
@@ -950,10 +991,12 @@ void QKernel(const int NE, const int NQ,
              const Vector &e_quads,
              const Vector &grad_v_ext,
              const DenseTensor &Jac0inv,
+             const double dt_est0,
              Vector &dt_est,
              DenseTensor &stressJinvT)
 {
    constexpr int DIM2 = DIM*DIM;
+   constexpr int NQ1D = DIM == 2 ? Q1D*Q1D : Q1D*Q1D*Q1D;
    auto d_gamma = gamma_gf.Read();
    auto d_weights = weights.Read();
    auto d_Jacobians = Jacobians.Read();
@@ -961,7 +1004,8 @@ void QKernel(const int NE, const int NQ,
    auto d_e_quads = e_quads.Read();
    auto d_grad_v_ext = grad_v_ext.Read();
    auto d_Jac0inv = Read(Jac0inv.GetMemory(), Jac0inv.TotalSize());
-   auto d_dt_est = dt_est.ReadWrite();
+   // One partial minimum of the time step estimate per element (block).
+   auto d_dt_est = dt_est.Write();
    auto d_stressJinvT = Write(stressJinvT.GetMemory(), stressJinvT.TotalSize());
    if (DIM == 2)
    {
@@ -976,20 +1020,31 @@ void QKernel(const int NE, const int NQ,
          double Jpi[DIM2];
          double ph_dir[DIM];
          double stressJiT[DIM2];
+         MFEM_SHARED double dt_min[NQ1D];
          MFEM_FOREACH_THREAD(qx,x,Q1D)
          {
             MFEM_FOREACH_THREAD(qy,y,Q1D)
             {
-               QUpdateBody<DIM>(NE, e, NQ, qx + qy * Q1D,
+               const int q = qx + qy * Q1D;
+               double dt_q = dt_est0;
+               QUpdateBody<DIM>(NE, e, NQ, q,
                use_viscosity, h0, h1order, cfl, infinity,
                Jinv, stress, sgrad_v, eig_val_data, eig_vec_data,
                compr_dir, Jpi, ph_dir, stressJiT,
                d_gamma, d_weights, d_Jacobians, d_rho0DetJ0w,
                d_e_quads, d_grad_v_ext, d_Jac0inv,
-               d_dt_est, d_stressJinvT);
+               dt_q, d_stressJinvT);
+               dt_min[q] = dt_q;
             }
          }
          MFEM_SYNC_THREAD;
+         if (MFEM_THREAD_ID(x) == 0 && MFEM_THREAD_ID(y) == 0)
+         {
+            double dt_e = dt_min[0];
+            for (int q = 1; q < NQ1D; q++) { dt_e = fmin(dt_e, dt_min[q]); }
+            d_dt_est[e] = dt_e;
+         }
+         MFEM_SYNC_THREAD;
       });
    }
    if (DIM == 3)
@@ -1005,23 +1060,35 @@ void QKernel(const int NE, const int NQ,
          double Jpi[DIM2];
          double ph_dir[DIM];
          double stressJiT[DIM2];
+         MFEM_SHARED double dt_min[NQ1D];
          MFEM_FOREACH_THREAD(qx,x,Q1D)
          {
             MFEM_FOREACH_THREAD(qy,y,Q1D)
             {
                MFEM_FOREACH_THREAD(qz,z,Q1D)
                {
-                  QUpdateBody<DIM>(NE, e, NQ, qx + Q1D * (qy + qz * Q1D),
+                  const int q = qx + Q1D * (qy + qz * Q1D);
+                  double dt_q = dt_est0;
+                  QUpdateBody<DIM>(NE, e, NQ, q,
                   use_viscosity, h0, h1order, cfl, infinity,
                   Jinv, stress, sgrad_v, eig_val_data, eig_vec_data,
                   compr_dir, Jpi, ph_dir, stressJiT,
                   d_gamma, d_weights, d_Jacobians, d_rho0DetJ0w,
                   d_e_quads, d_grad_v_ext, d_Jac0inv,
-                  d_dt_est, d_stressJinvT);
+                  dt_q, d_stressJinvT);
+                  dt_min[q] = dt_q;
                }
             }
          }
          MFEM_SYNC_THREAD;
+         if (MFEM_THREAD_ID(x) == 0 && MFEM_THREAD_ID(y) == 0 &&
+             MFEM_THREAD_ID(z) == 0)
+         {
+            double dt_e = dt_min[0];
+            for (int q = 1; q < NQ1D; q++) { dt_e = fmin(dt_e, dt_min[q]); }
+            d_dt_est[e] = dt_e;
+         }
+         MFEM_SYNC_THREAD;
       });
    }
 }
@@ -1044,7 +1111,6 @@ void QUpdate::UpdateQuadratureData(const Vector &S, QuadratureData &qdata)
    e.MakeRef(&L2, *S_p, 2*H1_size);
    q2->SetOutputLayout(QVectorLayout::byVDIM);
    q2->Values(e, q_e);
-   q_dt_est = qdata.dt_est;
    const int id = (dim << 4) | Q1D;
    typedef void (*fQKernel)(const int NE, const int NQ,
                             const bool use_viscosity,
@@ -1054,7 +1120,7 @@ void QUpdate::UpdateQuadratureData(const Vector &S, QuadratureData &qdata)
                             const Array<double> &weights,
                             const Vector &Jacobians, const Vector &rho0DetJ0w,
                             const Vector &e_quads, const Vector &grad_v_ext,
-                            const DenseTensor &Jac0inv,
+                            const DenseTensor &Jac0inv, const double dt_est0,
                             Vector &dt_est, DenseTensor &stressJinvT);
    static std::unordered_map<int, fQKernel> qupdate =
    {
@@ -1069,8 +1135,15 @@ void QUpdate::UpdateQuadratureData(const Vector &S, QuadratureData &qdata)
    qupdate[id](NE, NQ, use_viscosity, qdata.h0, h1order, cfl, infinity,
                gamma_gf, ir.GetWeights(), q_dx,
                qdata.rho0DetJ0w, q_e, q_dv,
-               qdata.Jac0inv, q_dt_est, qdata.stressJinvT);
-   qdata.dt_est = q_dt_est.Min();
+               qdata.Jac0inv, qdata.dt_est, q_dt_est, qdata.stressJinvT);
+   // Final reduction over the per-element partial minima. The minimum does not
+   // depend on the evaluation order, so the estimate is the same for any
+   // number of threads.
+   const double *h_dt_est = q_dt_est.HostRead();
+   double dt_est = qdata.dt_est;
+   LAGHOS_OMP(parallel for schedule(static) reduction(min:dt_est))
+   for (int k = 0; k < NE; k++) { dt_est = fmin(dt_est, h_dt_est[k]); }
+   qdata.dt_est = dt_est;
    timer->sw_qdata.Stop();
    timer->quad_tstep += NE;
 }
@@ -1080,7 +1153,35 @@ void LagrangianHydroOperator::AssembleForceMatrix() const
    if (forcemat_is_assembled || p_assembly) { return; }
    Force = 0.0;
    timer.sw_force.Start();
+#if defined(_OPENMP) && defined(MFEM_THREAD_SAFE)
+   // The element matrices are computed by the threads, while their (cheap)
+   // scatter into the shared sparsity pattern is done in zone order, as in
+   // MixedBilinearForm::Assemble().
+   const int h1vdofs_cnt = h1dofs_cnt * dim;
+   Force_el.SetSize(h1vdofs_cnt, l2dofs_cnt, NE);
+   LAGHOS_OMP_FE(parallel)
+   {
+      ForceIntegrator fi(qdata);
+      fi.SetIntRule(&ir);
+      IsoparametricTransformation Tr;
+      LAGHOS_OMP_FE(for schedule(static))
+      for (int e = 0; e < NE; e++)
+      {
+         mesh->GetElementTransformation(e, &Tr);
+         fi.AssembleElementMatrix2(*L2.GetFE(e), *H1.GetFE(e), Tr, Force_el(e));
+      }
+   }
+   SparseMatrix &F = Force.SpMat();
+   Array<int> h1vdofs, l2vdofs;
+   for (int e = 0; e < NE; e++)
+   {
+      H1.GetElementVDofs(e, h1vdofs);
+      L2.GetElementVDofs(e, l2vdofs);
+      F.AddSubMatrix(h1vdofs, l2vdofs, Force_el(e));
+   }
+#else
    Force.Assemble();
+#endif
    timer.sw_force.Stop();
    forcemat_is_assembled = true;
 }
@@ -1105,11 +1206,35 @@ void RK2AvgSolver::Init(TimeDependentOperator &tdop)
    S0.Update(block_offsets, mem_type);
 }
 
+// z = x + a y. Without a device backend, MFEM's vector kernels run on a single
+// host core, so the update is threaded here.
+static void ThreadedAdd(const Vector &x, const double a, const Vector &y,
+                        Vector &z)
+{
+   if (Device::IsEnabled()) { add(x, a, y, z); return; }
+   const int n = z.Size();
+   const double *xd = x.HostRead(), *yd = y.HostRead();
+   double *zd = z.HostWrite();
+   LAGHOS_OMP(parallel for schedule(static))
+   for (int i = 0; i < n; i++) { zd[i] = xd[i] + a * yd[i]; }
+}
+
+// y = x, threaded as above.
+static void ThreadedCopy(const Vector &x, Vector &y)
+{
+   if (Device::IsEnabled()) { y = x; return; }
+   const int n = y.Size();
+   const double *xd = x.HostRead();
+   double *yd = y.HostWrite();
+   LAGHOS_OMP(parallel for schedule(static))
+   for (int i = 0; i < n; i++) { yd[i] = xd[i]; }
+}
+
 void RK2AvgSolver::Step(Vector &S, double &t, double &dt)
 {
    // The monolithic BlockVector stores the unknown fields as follows:
    // (Position, Velocity, Specific Internal Energy).
-   S0.Vector::operator=(S);
+   ThreadedCopy(S, S0);
    Vector &v0 = S0.GetBlock(1);
    Vector &dx_dt = dS_dt.GetBlock(0);
    Vector &dv_dt = dS_dt.GetBlock(1);
@@ -1125,24 +1250,24 @@ void RK2AvgSolver::Step(Vector &S, double &t, double &dt)
    hydro_oper->UpdateMesh(S);
    hydro_oper->SolveVelocity(S, dS_dt);
    // V = v0 + 0.5 * dt * dv_dt;
-   add(v0, 0.5 * dt, dv_dt, V);
+   ThreadedAdd(v0, 0.5 * dt, dv_dt, V);
    hydro_oper->SolveEnergy(S, V, dS_dt);
-   dx_dt = V;
+   ThreadedCopy(V, dx_dt);
 
    // -- 2.
    // S = S0 + 0.5 * dt * dS_dt;
-   add(S0, 0.5 * dt, dS_dt, S);
+   ThreadedAdd(S0, 0.5 * dt, dS_dt, S);
    hydro_oper->ResetQuadratureData();
    hydro_oper->UpdateMesh(S);
    hydro_oper->SolveVelocity(S, dS_dt);
    // V = v0 + 0.5 * dt * dv_dt;
-   add(v0, 0.5 * dt, dv_dt, V);
+   ThreadedAdd(v0, 0.5 * dt, dv_dt, V);
    hydro_oper->SolveEnergy(S, V, dS_dt);
-   dx_dt = V;
+   ThreadedCopy(V, dx_dt);
 
    // -- 3.
    // S = S0 + dt * dS_dt.
-   add(S0, dt, dS_dt, S);
+   ThreadedAdd(S0, dt, dS_dt, S);
    hydro_oper->ResetQuadratureData();
    t += dt;
 }
@@ -77,7 +77,7 @@ public:
       use_viscosity(visc), cfl(cfl),
       timer(t), ir(ir), H1(h1), L2(l2),
       H1R(H1.GetElementRestriction(ElementDofOrdering::LEXICOGRAPHIC)),
-      q_dt_est(NE*NQ),
+      q_dt_est(NE),
       q_e(NE*NQ),
       e_vec(NQ*NE*vdim),
       q_dx(NQ*NE*vdim*vdim),
@@ -130,6 +130,8 @@ protected:
    // assembled in each time step and then it is used to compute the final
    // right-hand sides for momentum and specific internal energy.
    mutable MixedBilinearForm Force;
+   // Element force matrices, used when the FA assembly is threaded.
+   mutable DenseTensor Force_el;
    // Same as above, but done through partial assembly.
    ForcePAOperator *ForcePA;
    // Mass matrices done through partial assembly:
@@ -0,0 +1,74 @@
+// Copyright (c) 2017, Lawrence Livermore National Security, LLC. Produced at
+// the Lawrence Livermore National Laboratory. LLNL-CODE-734707. All Rights
+// reserved. See files LICENSE and NOTICE for details.
+//
+// This file is part of CEED, a collection of benchmarks, miniapps, software
+// libraries and APIs for efficient high-order finite element and spectral
+// element discretizations for exascale applications. For more information and
+// source code availability see http://github.com/ceed.
+//
+// The CEED research is supported by the Exascale Computing Project 17-SC-20-SC,
+// a collaborative effort of two U.S. Department of Energy organizations (Office
+// of Science and the National Nuclear Security Administration) responsible for
+// the planning and preparation of a capable exascale ecosystem, including
+// software, applications, hardware, advanced system engineering and early
+// testbed platforms, in support of the nation's exascale computing imperative.
+
+
+//                 Laghos 64-bit counter test
+//
+// Checks that the global counts of the timing and FOM accounting do not wrap
+// around in 32-bit arithmetic. Each rank sets synthetic local counts above
+// 2^31, and the sums of GlobalCount() and GlobalFOMCounts(), the counts used
+// by LagrangianHydroOperator::PrintTimingData(), are compared with their exact
+// values. The run fails with an error message when a count is wrong.
+//
+// Compile with: make tests/laghos_counts
+//
+// Sample runs:
+//    tests/laghos_counts
+//    mpirun -np 4 tests/laghos_counts
+
+#include "laghos_solver.hpp"
+#include <climits>
+#include <iostream>
+
+using namespace mfem;
+using namespace mfem::hydrodynamics;
+
+int main(int argc, char *argv[])
+{
+   MPI_Session mpi(argc, argv);
+   const MPI_Comm comm = MPI_COMM_WORLD;
+   const long long nranks = mpi.WorldSize();
+   const long long big = 1LL << 31;
+
+   // Sum of big + rank over the ranks.
+   const long long count = GlobalCount(comm, big + mpi.WorldRank());
+   MFEM_VERIFY(count == nranks * big + nranks * (nranks - 1) / 2,
+               "GlobalCount() returned " << count);
+
+   // Per rank: 2^20 L2 dofs times 2^12 CG iterations, 3 * 2^30 quadrature
+   // point updates and 2^28 zones with 64 points each.
+   TimingData timer(1LL << 20);
+   timer.L2iter = 1LL << 12;
+   timer.quad_tstep = 3LL << 30;
+   const long long NE = 1LL << 28;
+   const int QPT = 64;
+   const long long H1GTVSize = 3LL << 31, L2GTVSize = 5LL << 30;
+   const FOMCounts counts =
+      GlobalFOMCounts(comm, timer, NE, QPT, H1GTVSize, L2GTVSize);
+   MFEM_VERIFY(counts.L2dof_iter == nranks * (1LL << 32),
+               "Wrong L2 dofs x iterations: " << counts.L2dof_iter);
+   MFEM_VERIFY(counts.quad_tstep == nranks * (3LL << 30),
+               "Wrong quadrature point updates: " << counts.quad_tstep);
+   MFEM_VERIFY(counts.zones == nranks * NE,
+               "Wrong number of zones: " << counts.zones);
+   MFEM_VERIFY(counts.ndofs == 2 * H1GTVSize + L2GTVSize +
+               nranks * (1LL << 34), "Wrong FOM dofs: " << counts.ndofs);
+   MFEM_VERIFY(counts.L2dof_iter > INT_MAX && counts.ndofs > INT_MAX,
+               "The synthetic counts do not exceed 32 bits.");
+
+   if (mpi.Root()) { std::cout << "64-bit counts: OK" << std::endl; }
+   return 0;
+}